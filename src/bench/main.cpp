@@ -0,0 +1,193 @@
+#include "graphkit.h"
+#include "graphkitcompact.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+template <typename F>
+double TimeIt(F&& f)
+{
+    const auto beginTime = std::chrono::steady_clock::now();
+    f();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - beginTime;
+    return elapsed.count();
+}
+
+// Directed graph with n nodes and n * avgDegr edges whose endpoints are drawn uniformly.
+gkit::CSR RandomDiGraph(gkit::node_t n, double avgDegr, std::uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<gkit::node_t> dist(0, n - 1);
+    std::vector<std::vector<gkit::node_t>> adjs(n);
+    for (std::uint64_t i = 0; i < static_cast<std::uint64_t>(n * avgDegr); i++)
+        adjs[dist(rng)].push_back(dist(rng));
+    return gkit::CSR(adjs);
+}
+
+// Writes the edges of adjs as a SNAP-style edge list.
+void WriteEdgeList(const std::filesystem::path& path, const gkit::CSR& adjs)
+{
+    std::ofstream out(path);
+    out << "# Random edge list\n";
+    for (gkit::node_t u = 0; u < adjs.size(); u++)
+        for (const gkit::node_t& v : adjs[u])
+            out << u << '\t' << v << '\n';
+}
+
+// Ingest throughput of an edge list file, read through a stream and through a mapping.
+void IngestBench(const std::string& desc, const std::filesystem::path& path)
+{
+    const double megabytes = std::filesystem::file_size(path) * 1e-6;
+    gkit::offset_t m = 0;
+    const double streamSeconds = TimeIt([&]() {
+        std::ifstream in(path);
+        m = gkit::SimpleDiGraph(std::string(desc), in, gkit::ComponentPolicy::Full).m;
+    });
+    const double mapSeconds = TimeIt([&]() { m = gkit::SimpleDiGraph(std::string(desc), path, gkit::ComponentPolicy::Full).m; });
+    std::cout << std::format("{} ({:.1f} MB, {} edges), ingest on {} threads: stream {:.3f}s ({:.1f} MB/s), mmap {:.3f}s ({:.1f} MB/s).\n", desc, megabytes, m,
+        gkit::GetThreadNum(), streamSeconds, megabytes / streamSeconds, mapSeconds, megabytes / mapSeconds);
+}
+
+// Relabels endpoints drawn from n sparse 40-bit IDs to 0..n-1, through IDMap and through a
+// sorted ID list with an unordered_map index.
+void RelabelBench(gkit::node_t n, std::uint64_t endpointNum, std::uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<gkit::rawID_t> ids(n), endpoints(endpointNum);
+    for (gkit::rawID_t& id : ids)
+        id = rng() >> 24;
+    for (gkit::rawID_t& e : endpoints)
+        e = ids[rng() % n];
+    std::vector<gkit::node_t> ranks(endpointNum);
+    const double idMapSeconds = TimeIt([&]() {
+        const gkit::IDMap idMap{ std::vector<gkit::rawID_t>(endpoints) };
+        ParallelFor(gkit::GetThreadNum(), 0, endpointNum, 1 << 16, [&](std::uint64_t i) { ranks[i] = idMap[endpoints[i]]; });
+    });
+    const double hashSeconds = TimeIt([&]() {
+        std::vector<gkit::rawID_t> sorted(endpoints);
+        std::ranges::sort(sorted);
+        sorted.erase(std::ranges::unique(sorted).begin(), sorted.end());
+        std::unordered_map<gkit::rawID_t, gkit::node_t> index;
+        for (gkit::node_t i = 0; i < sorted.size(); i++)
+            index.emplace(sorted[i], i);
+        for (std::uint64_t i = 0; i < endpointNum; i++)
+            ranks[i] = index.at(endpoints[i]);
+    });
+    std::cout << std::format("Relabel {} endpoints of {} 40-bit IDs on {} threads: IDMap {:.3f}s, unordered_map {:.3f}s.\n", endpointNum, n, gkit::GetThreadNum(),
+        idMapSeconds, hashSeconds);
+}
+
+void SCCBench(const std::string& desc, const gkit::CSR& adjs)
+{
+    const std::pair<gkit::SCCAlgorithm, const char*> algorithms[] = { { gkit::SCCAlgorithm::Tarjan, "Tarjan" }, { gkit::SCCAlgorithm::ForwardBackward, "ForwardBackward" } };
+    for (const auto& [algorithm, algorithmName] : algorithms) {
+        std::vector<gkit::node_t> label;
+        const double seconds = TimeIt([&]() { label = gkit::LabelSCC(adjs, algorithm); });
+        std::vector<gkit::node_t> size(adjs.size());
+        for (const gkit::node_t& l : label)
+            size[l]++;
+        const gkit::node_t sccNum = std::ranges::count_if(size, [](gkit::node_t s) { return s > 0; });
+        std::cout << std::format("{} ({}, {}), {} on {} threads: {:.3f}s, {} SCCs, largest {}.\n", desc, adjs.size(), adjs.targets.size(), algorithmName,
+            gkit::GetThreadNum(), seconds, sccNum, std::ranges::max(size));
+    }
+}
+
+// Traversed edges per second over a few sources, counting the out-arcs of every reached node
+// (both directions of an undirected edge).
+template <typename G>
+void BFSBench(const std::string& desc, const G& g)
+{
+    const std::pair<gkit::BFSDirection, const char*> directions[] = { { gkit::BFSDirection::Auto, "Auto" }, { gkit::BFSDirection::TopDown, "TopDown" } };
+    std::mt19937_64 rng(42);
+    std::vector<gkit::node_t> sources(8);
+    for (gkit::node_t& s : sources)
+        s = rng() % g.nodeNum();
+    for (const auto& [direction, directionName] : directions) {
+        std::uint64_t arcNum = 0;
+        double seconds = 0;
+        for (const gkit::node_t& s : sources) {
+            gkit::BFSTree tree;
+            seconds += TimeIt([&]() { tree = gkit::BFS(g, s, direction); });
+            for (gkit::node_t u = 0; u < g.nodeNum(); u++)
+                if (tree.reached(u))
+                    arcNum += g.adjs.degree(u);
+        }
+        std::cout << std::format("{} ({}, {}), BFS {} on {} threads: {:.3f}s, {:.3f} GTEPS.\n", desc, g.nodeNum(), g.edgeNum(), directionName,
+            gkit::GetThreadNum(), seconds, arcNum / seconds * 1e-9);
+    }
+}
+
+void TriangleBench(const gkit::SimpleUndiGraph& g)
+{
+    const std::pair<gkit::IntersectionKernel, const char*> kernels[] = { { gkit::IntersectionKernel::Scalar, "Scalar" }, { gkit::IntersectionKernel::Auto, "Auto" } };
+    for (const auto& [kernel, kernelName] : kernels) {
+        gkit::SetIntersectionKernel(kernel);
+        std::uint64_t triangleNum = 0;
+        const double seconds = TimeIt([&]() { triangleNum = gkit::TriangleNum(g); });
+        std::cout << std::format("{} ({}, {}), triangles with {} kernel on {} threads: {:.3f}s, {} triangles.\n", g.name, g.nodeNum(), g.edgeNum(), kernelName,
+            gkit::GetThreadNum(), seconds, triangleNum);
+    }
+    gkit::SetIntersectionKernel(gkit::IntersectionKernel::Auto);
+}
+
+void SolverBench(const gkit::SimpleUndiGraph& g)
+{
+    const std::pair<gkit::LaplacianPreconditioner, const char*> preconditioners[] = { { gkit::LaplacianPreconditioner::None, "no" },
+        { gkit::LaplacianPreconditioner::Jacobi, "Jacobi" }, { gkit::LaplacianPreconditioner::IncompleteCholesky, "incomplete Cholesky" } };
+    const Eigen::MatrixXd rhs = Eigen::MatrixXd::Random(g.nodeNum(), 32);
+    for (const auto& [preconditioner, preconditionerName] : preconditioners) {
+        const gkit::LaplacianSolver solver(g, preconditioner);
+        unsigned iterations = 0;
+        const double seconds = TimeIt([&]() { solver.solve(rhs, &iterations); });
+        std::cout << std::format("{} ({}, {}), 32 Laplacian solves with {} preconditioner on {} threads: {:.3f}s, {} iterations.\n", g.name, g.nodeNum(), g.edgeNum(),
+            preconditionerName, gkit::GetThreadNum(), seconds, iterations);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const gkit::node_t n = gkit::node_t(1) << (argc > 1 ? std::stoi(argv[1]) : 20);
+    const std::filesystem::path edgeListPath = std::filesystem::temp_directory_path() / "graphkit_bench_edges.txt";
+    WriteEdgeList(edgeListPath, RandomDiGraph(n, 8.0, 42));
+    for (unsigned threadNum : { 1u, std::thread::hardware_concurrency() }) {
+        gkit::SetThreadNum(threadNum);
+        IngestBench("Random d=8", edgeListPath);
+    }
+    std::filesystem::remove(edgeListPath);
+    for (unsigned threadNum : { 1u, std::thread::hardware_concurrency() }) {
+        gkit::SetThreadNum(threadNum);
+        RelabelBench(n, std::uint64_t(n) * 20, 42);
+    }
+    for (double avgDegr : { 1.5, 4.0 }) {
+        const gkit::CSR adjs = RandomDiGraph(n, avgDegr, 42);
+        gkit::SetThreadNum(1);
+        SCCBench(std::format("Random d={}", avgDegr), adjs);
+        gkit::SetThreadNum(std::thread::hardware_concurrency());
+        SCCBench(std::format("Random d={}", avgDegr), adjs);
+    }
+    const gkit::SimpleUndiGraph pseudoG = gkit::LoadPseudo(12), apolloG = gkit::LoadApollo(12);
+    const gkit::SimpleUndiGraph solverPseudoG = gkit::LoadPseudo(10), solverApolloG = gkit::LoadApollo(9);
+    gkit::CSR randomAdjs = RandomDiGraph(n, 8.0, 42);
+    const gkit::offset_t randomM = randomAdjs.targets.size();
+    const gkit::SimpleDiGraph randomG(n, randomM, "Random", std::move(randomAdjs));
+    for (unsigned threadNum : { 1u, std::thread::hardware_concurrency() }) {
+        gkit::SetThreadNum(threadNum);
+        BFSBench(pseudoG.name, pseudoG);
+        BFSBench(apolloG.name, apolloG);
+        BFSBench("Random d=8", randomG);
+        TriangleBench(apolloG);
+        TriangleBench(pseudoG);
+        SolverBench(solverPseudoG);
+        SolverBench(solverApolloG);
+    }
+    return 0;
+}
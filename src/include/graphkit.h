@@ -1,19 +1,229 @@
 #pragma once
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
+#include <cstdint>
 #include <filesystem>
 #include <functional>
 #include <istream>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <ostream>
 #include <set>
+#include <span>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 namespace gkit {
+// Index widths are chosen at build time: GKIT_NODE32 makes node IDs 32-bit and GKIT_OFFSET32
+// makes edge offsets and counts 32-bit. Loading a graph that does not fit terminates.
+#ifdef GKIT_NODE32
+using node_t = std::uint32_t;
+#else
 using node_t = std::uint64_t;
+#endif
+#ifdef GKIT_OFFSET32
+using offset_t = std::uint32_t;
+#else
+using offset_t = std::uint64_t;
+#endif
 using weight_t = std::int64_t;
+// Node IDs as written in edge lists. They stay 64-bit in every build, so a GKIT_NODE32 build
+// loads any input whose node count fits, however sparse its IDs.
+using rawID_t = std::uint64_t;
+
+// Number of threads used by parallel routines, hardware_concurrency() by default.
+void SetThreadNum(unsigned threadNum);
+unsigned GetThreadNum();
+
+// Sequential source of edge list text that arrives in chunks, e.g. from a decompressor.
+struct EdgeStream {
+    virtual ~EdgeStream() = default;
+    // Returns the next chunk, or an empty view at the end of the input.
+    // The view stays valid until the following call.
+    virtual std::string_view next() = 0;
+    // Progress in arbitrary units, for reporting only.
+    virtual std::uint64_t size() const = 0;
+    virtual std::uint64_t position() const = 0;
+};
+
+// Fills weights[i] with the weight of edge first + i, edges being numbered from 0 in file order.
+// A filler must depend only on the edge index, so that the weights do not depend on the thread count.
+using WeightFiller = std::function<void(std::uint64_t first, std::span<weight_t> weights)>;
+
+// Counter-based fillers: the weight of edge i is a hash of (seed, i).
+// Uniform on [lo, hi].
+WeightFiller UniformWeights(std::uint64_t seed, weight_t lo, weight_t hi);
+// -1 with probability negRatio, otherwise +1.
+WeightFiller SignWeights(std::uint64_t seed, double negRatio);
+// Calls filler on blocks of weights in parallel; weights[i] is the weight of edge first + i.
+void FillWeights(const WeightFiller& filler, std::span<weight_t> weights, std::uint64_t first = 0);
+
+// Adjacency lists in compressed sparse row form: the neighbours of u are
+// targets[offsets[u]], ..., targets[offsets[u + 1] - 1], and offsets has size() + 1 entries.
+struct CSR {
+    std::vector<offset_t> offsets;
+    std::vector<node_t> targets;
+    CSR()
+        : offsets(1, 0)
+    {
+    }
+    CSR(std::vector<offset_t>&& offsets, std::vector<node_t>&& targets)
+        : offsets(std::move(offsets))
+        , targets(std::move(targets))
+    {
+    }
+    CSR(const std::vector<std::vector<node_t>>& adjs);
+    node_t size() const { return offsets.size() - 1; }
+    node_t degree(node_t u) const { return offsets[u + 1] - offsets[u]; }
+    std::span<const node_t> operator[](node_t u) const { return { targets.data() + offsets[u], targets.data() + offsets[u + 1] }; }
+    std::span<node_t> operator[](node_t u) { return { targets.data() + offsets[u], targets.data() + offsets[u + 1] }; }
+    bool operator==(const CSR& other) const = default;
+};
+
+// A CSR derived from another one and built by the first get(), once even under concurrent calls.
+// Copies start empty, so a copy whose source array is then changed does not see a stale result.
+struct CSRCache {
+    std::unique_ptr<std::once_flag> once = std::make_unique<std::once_flag>();
+    std::unique_ptr<const CSR> csr;
+    CSRCache() = default;
+    CSRCache(const CSRCache&)
+        : CSRCache()
+    {
+    }
+    CSRCache& operator=(const CSRCache&)
+    {
+        once = std::make_unique<std::once_flag>(), csr.reset();
+        return *this;
+    }
+    template <typename F>
+    const CSR& get(F&& build)
+    {
+        std::call_once(*once, [&]() { csr = std::make_unique<const CSR>(build()); });
+        return *csr;
+    }
+};
+
+// Which Laplacian an operator applies: Combinatorial is D - A, Normalized is I - D^-1/2 A D^-1/2
+// with a zero row and column for isolated nodes. On signed graphs A has -1 on negative edges and
+// D counts edges of both signs.
+enum class LaplacianKind {
+    Combinatorial,
+    Normalized
+};
+struct LaplacianOperator;
+}
+
+namespace Eigen::internal {
+template <>
+struct traits<gkit::LaplacianOperator> : traits<SparseMatrix<double>> {
+};
+}
+
+namespace gkit {
+// Matrix-free Laplacian over the adjacency lists of a graph, which must outlive it; D holds
+// out-degrees on directed graphs. It can stand for the matrix in Eigen's ConjugateGradient and
+// BiCGSTAB; products run on GetThreadNum() threads.
+struct LaplacianOperator : Eigen::EigenBase<LaplacianOperator> {
+    using Scalar = double;
+    using RealScalar = double;
+    using StorageIndex = int;
+    enum {
+        ColsAtCompileTime = Eigen::Dynamic,
+        MaxColsAtCompileTime = Eigen::Dynamic,
+        IsRowMajor = false
+    };
+    const CSR& posAdjs;
+    // Null for unsigned graphs.
+    const CSR* negAdjs;
+    LaplacianKind kind;
+    Eigen::VectorXd degr;
+    // D^-1/2 for Normalized, 0 on isolated nodes; empty for Combinatorial.
+    Eigen::VectorXd invSqrtDegr;
+    LaplacianOperator(const CSR& adjs, LaplacianKind kind);
+    LaplacianOperator(const CSR& posAdjs, const CSR& negAdjs, LaplacianKind kind);
+    Eigen::Index rows() const { return posAdjs.size(); }
+    Eigen::Index cols() const { return posAdjs.size(); }
+    Eigen::VectorXd diagonal() const;
+    // y = L x.
+    void apply(const Eigen::VectorXd& x, Eigen::VectorXd& y) const;
+    template <typename Rhs>
+    Eigen::Product<LaplacianOperator, Rhs, Eigen::AliasFreeProduct> operator*(const Eigen::MatrixBase<Rhs>& x) const
+    {
+        return Eigen::Product<LaplacianOperator, Rhs, Eigen::AliasFreeProduct>(*this, x.derived());
+    }
+};
+}
+
+namespace Eigen::internal {
+template <typename Rhs>
+struct generic_product_impl<gkit::LaplacianOperator, Rhs, SparseShape, DenseShape, GemvProduct>
+    : generic_product_impl_base<gkit::LaplacianOperator, Rhs, generic_product_impl<gkit::LaplacianOperator, Rhs>> {
+    template <typename Dest>
+    static void scaleAndAddTo(Dest& dst, const gkit::LaplacianOperator& lhs, const Rhs& rhs, const double& alpha)
+    {
+        Eigen::VectorXd y(lhs.rows());
+        lhs.apply(rhs, y);
+        dst.noalias() += alpha * y;
+    }
+};
+}
+
+namespace gkit {
+// Algorithm for strongly connected components. Tarjan runs on one thread; ForwardBackward
+// trims, searches forward and backward from a pivot and colours the rest on GetThreadNum()
+// threads. Auto picks ForwardBackward for large graphs when several threads are available.
+enum class SCCAlgorithm {
+    Auto,
+    Tarjan,
+    ForwardBackward
+};
+void SetSCCAlgorithm(SCCAlgorithm algorithm);
+SCCAlgorithm GetSCCAlgorithm();
+// Labels every node of a dense directed graph with a member of its SCC.
+std::vector<node_t> LabelSCC(const CSR& adjs, SCCAlgorithm algorithm = GetSCCAlgorithm());
+// Labels every node of a dense undirected graph with the smallest node of its component.
+std::vector<node_t> LabelCC(const CSR& adjs);
+
+// Kernel for intersecting sorted lists. Auto picks the widest one the CPU supports; asking for a
+// kernel the CPU lacks terminates.
+enum class IntersectionKernel {
+    Auto,
+    Scalar,
+    AVX2,
+    AVX512
+};
+void SetIntersectionKernel(IntersectionKernel kernel);
+IntersectionKernel GetIntersectionKernel();
+// Number of common elements of two sorted lists of distinct nodes.
+std::uint64_t IntersectionSize(std::span<const node_t> a, std::span<const node_t> b, IntersectionKernel kernel = GetIntersectionKernel());
+
+// Connected components of an undirected graph, or strongly connected components of a directed one.
+// Components are numbered by decreasing size, equal sizes by their smallest node, so component 0
+// is what LCC() or LSCC() keeps.
+struct Components {
+    // Node IDs of a raw graph in increasing order, componentID[i] belonging to nodes[i].
+    // Empty for compacted graphs, whose node IDs index componentID directly.
+    std::vector<rawID_t> nodes;
+    std::vector<node_t> componentID;
+    std::vector<node_t> sizes;
+    node_t componentNum() const { return sizes.size(); }
+    node_t componentOf(node_t u) const;
+    // Number of components of each size.
+    std::map<node_t, node_t> sizeHistogram() const;
+};
+
+// Part of the input kept by the compacted-graph constructors. Largest keeps the LCC, or the LSCC
+// for directed graphs. Full keeps every node with an edge and skips the component pass, e.g. for
+// inputs already known to be (strongly) connected.
+enum class ComponentPolicy {
+    Largest,
+    Full
+};
 
 struct UnweightedUndiGraph;
 struct UnweightedDiGraph;
@@ -24,6 +234,47 @@ struct SimpleDiGraph;
 struct SignedUndiGraph;
 struct SignedDiGraph;
 
+// Expansion of a signed graph read in place from its posAdjs and negAdjs: node u < n and its copy
+// u + n have the positive neighbours on their own side and the negative ones on the other side.
+// The graph must outlive the view.
+struct ExpansionView {
+    node_t n;
+    const CSR& posAdjs;
+    const CSR& negAdjs;
+    // Set for undirected graphs, whose expansion is its own transpose.
+    bool symmetric;
+    ExpansionView(node_t n, const CSR& posAdjs, const CSR& negAdjs, bool symmetric)
+        : n(n)
+        , posAdjs(posAdjs)
+        , negAdjs(negAdjs)
+        , symmetric(symmetric)
+    {
+    }
+    ExpansionView(const SignedUndiGraph& g);
+    ExpansionView(const SignedDiGraph& g);
+    node_t nodeNum() const { return n << 1; }
+    node_t degree(node_t u) const { return posAdjs.degree(u < n ? u : u - n) + negAdjs.degree(u < n ? u : u - n); }
+    // Calls f(v) for every neighbour v of u, in increasing order.
+    template <typename F>
+    void forEachNeighbor(node_t u, F&& f) const
+    {
+        if (u < n) {
+            for (const node_t& v : posAdjs[u])
+                f(v);
+            for (const node_t& v : negAdjs[u])
+                f(v + n);
+        } else {
+            for (const node_t& v : negAdjs[u - n])
+                f(v);
+            for (const node_t& v : posAdjs[u - n])
+                f(v + n);
+        }
+    }
+    Eigen::VectorXd degrVec() const;
+    Eigen::DiagonalMatrix<double, Eigen::Dynamic> degrMat() const;
+    Eigen::SparseMatrix<double> adjMat() const;
+};
+
 struct UnweightedUndiGraph {
     std::string name;
     std::set<node_t> nodes;
@@ -42,9 +293,10 @@ struct UnweightedUndiGraph {
     }
     UnweightedUndiGraph(std::string&& name, std::istream& in);
     UnweightedUndiGraph(std::string&& name, const std::filesystem::path& source);
+    UnweightedUndiGraph(std::string&& name, EdgeStream& in);
     void Init(std::istream& in);
     node_t nodeNum() const { return nodes.size(); }
-    node_t edgeNum() const { return edges.size(); }
+    offset_t edgeNum() const { return edges.size(); }
     void addNode(node_t u);
     void addEdge(node_t u, node_t v);
     UnweightedUndiGraph LCC();
@@ -68,9 +320,10 @@ struct UnweightedDiGraph {
     }
     UnweightedDiGraph(std::string&& name, std::istream& in);
     UnweightedDiGraph(std::string&& name, const std::filesystem::path& source);
+    UnweightedDiGraph(std::string&& name, EdgeStream& in);
     void Init(std::istream& in);
     node_t nodeNum() const { return adjs.size(); }
-    node_t edgeNum() const { return edges.size(); }
+    offset_t edgeNum() const { return edges.size(); }
     void addNode(node_t u);
     void addEdge(node_t u, node_t v);
     UnweightedDiGraph LSCC();
@@ -94,12 +347,16 @@ struct WeightedUndiGraph {
     }
     WeightedUndiGraph(std::string&& name, std::istream& in);
     WeightedUndiGraph(std::string&& name, const std::filesystem::path& source);
+    WeightedUndiGraph(std::string&& name, EdgeStream& in);
     WeightedUndiGraph(std::string&& name, std::istream& in, std::function<weight_t()>&& generator);
     WeightedUndiGraph(std::string&& name, const std::filesystem::path& source, std::function<weight_t()>&& generator);
+    WeightedUndiGraph(std::string&& name, std::istream& in, const WeightFiller& filler);
+    WeightedUndiGraph(std::string&& name, const std::filesystem::path& source, const WeightFiller& filler);
+    WeightedUndiGraph(std::string&& name, EdgeStream& in, const WeightFiller& filler);
     void Init(std::istream& in);
     void Init(std::istream& in, std::function<weight_t()>&& generator);
     node_t nodeNum() const { return nodes.size(); }
-    node_t edgeNum() const { return edges.size(); }
+    offset_t edgeNum() const { return edges.size(); }
     void addNode(node_t u);
     void addEdge(node_t u, node_t v, weight_t w);
     WeightedUndiGraph LCC();
@@ -123,25 +380,39 @@ struct WeightedDiGraph {
     }
     WeightedDiGraph(std::string&& name, std::istream& in);
     WeightedDiGraph(std::string&& name, const std::filesystem::path& source);
+    WeightedDiGraph(std::string&& name, EdgeStream& in);
     WeightedDiGraph(std::string&& name, std::istream& in, std::function<weight_t()>&& generator);
     WeightedDiGraph(std::string&& name, const std::filesystem::path& source, std::function<weight_t()>&& generator);
+    WeightedDiGraph(std::string&& name, std::istream& in, const WeightFiller& filler);
+    WeightedDiGraph(std::string&& name, const std::filesystem::path& source, const WeightFiller& filler);
+    WeightedDiGraph(std::string&& name, EdgeStream& in, const WeightFiller& filler);
     void Init(std::istream& in);
     void Init(std::istream& in, std::function<weight_t()>&& generator);
     node_t nodeNum() const { return adjs.size(); }
-    node_t edgeNum() const { return edges.size(); }
+    offset_t edgeNum() const { return edges.size(); }
     void addNode(node_t u);
     void addEdge(node_t u, node_t v, weight_t w);
     WeightedDiGraph LSCC();
 };
 
 struct SimpleUndiGraph {
-    node_t n, m;
+    node_t n;
+    offset_t m;
     std::string name;
-    std::vector<std::vector<node_t>> adjs;
-    SimpleUndiGraph(node_t n, node_t m, std::string&& name, std::vector<std::vector<node_t>>&& adjs)
+    CSR adjs;
+    // ID in the source edge list of every node; empty for generated graphs.
+    std::vector<rawID_t> originalIDs;
+    SimpleUndiGraph(node_t n, offset_t m, std::string&& name, CSR&& adjs)
         : n(n)
         , m(m)
-        , name(name)
+        , name(std::move(name))
+        , adjs(std::move(adjs))
+    {
+    }
+    SimpleUndiGraph(node_t n, offset_t m, std::string&& name, const std::vector<std::vector<node_t>>& adjs)
+        : n(n)
+        , m(m)
+        , name(std::move(name))
         , adjs(adjs)
     {
     }
@@ -150,27 +421,56 @@ struct SimpleUndiGraph {
         , m(g.m)
         , name(g.name)
         , adjs(g.adjs)
+        , originalIDs(g.originalIDs)
+    {
+    }
+    SimpleUndiGraph(SimpleUndiGraph&& g)
+        : n(g.n)
+        , m(g.m)
+        , name(std::move(g.name))
+        , adjs(std::move(g.adjs))
+        , originalIDs(std::move(g.originalIDs))
     {
     }
-    SimpleUndiGraph(UnweightedUndiGraph&& g);
+    SimpleUndiGraph& operator=(const SimpleUndiGraph& g) = default;
+    SimpleUndiGraph& operator=(SimpleUndiGraph&& g) = default;
+    SimpleUndiGraph(UnweightedUndiGraph&& g, ComponentPolicy policy = ComponentPolicy::Largest);
     SimpleUndiGraph(SignedUndiGraph&& g);
-    SimpleUndiGraph(std::string&& name, std::istream& in);
-    SimpleUndiGraph(std::string&& name, const std::filesystem::path& source);
+    SimpleUndiGraph(std::string&& name, std::vector<std::pair<rawID_t, rawID_t>>&& edges, ComponentPolicy policy = ComponentPolicy::Largest);
+    SimpleUndiGraph(std::string&& name, std::istream& in, ComponentPolicy policy = ComponentPolicy::Largest);
+    SimpleUndiGraph(std::string&& name, const std::filesystem::path& source, ComponentPolicy policy = ComponentPolicy::Largest);
+    SimpleUndiGraph(std::string&& name, EdgeStream& in, ComponentPolicy policy = ComponentPolicy::Largest);
+    static SimpleUndiGraph load(const std::filesystem::path& path);
+    void save(const std::filesystem::path& path) const;
     node_t nodeNum() const { return n; }
-    node_t edgeNum() const { return m; }
+    offset_t edgeNum() const { return m; }
+    rawID_t originalID(node_t u) const { return originalIDs.empty() ? u : originalIDs[u]; }
     Eigen::VectorXd degrVec() const;
-    Eigen::SparseMatrix<double> degrMat() const;
+    Eigen::DiagonalMatrix<double, Eigen::Dynamic> degrMat() const;
     Eigen::SparseMatrix<double> adjMat() const;
+    LaplacianOperator laplacian(LaplacianKind kind = LaplacianKind::Combinatorial) const { return LaplacianOperator(adjs, kind); }
 };
 
 struct SimpleDiGraph {
-    node_t n, m;
+    node_t n;
+    offset_t m;
     std::string name;
-    std::vector<std::vector<node_t>> adjs;
-    SimpleDiGraph(node_t n, node_t m, std::string&& name, std::vector<std::vector<node_t>>&& adjs)
+    CSR adjs;
+    // ID in the source edge list of every node; empty for generated graphs.
+    std::vector<rawID_t> originalIDs;
+    // Built by the first InvAdjs() call; copies build their own.
+    mutable CSRCache invAdjsCache;
+    SimpleDiGraph(node_t n, offset_t m, std::string&& name, CSR&& adjs)
         : n(n)
         , m(m)
-        , name(name)
+        , name(std::move(name))
+        , adjs(std::move(adjs))
+    {
+    }
+    SimpleDiGraph(node_t n, offset_t m, std::string&& name, const std::vector<std::vector<node_t>>& adjs)
+        : n(n)
+        , m(m)
+        , name(std::move(name))
         , adjs(adjs)
     {
     }
@@ -179,28 +479,59 @@ struct SimpleDiGraph {
         , m(g.m)
         , name(g.name)
         , adjs(g.adjs)
+        , originalIDs(g.originalIDs)
     {
     }
-    SimpleDiGraph(UnweightedDiGraph&& g);
+    SimpleDiGraph(SimpleDiGraph&& g)
+        : n(g.n)
+        , m(g.m)
+        , name(std::move(g.name))
+        , adjs(std::move(g.adjs))
+        , originalIDs(std::move(g.originalIDs))
+    {
+    }
+    SimpleDiGraph& operator=(const SimpleDiGraph& g) = default;
+    SimpleDiGraph& operator=(SimpleDiGraph&& g) = default;
+    SimpleDiGraph(UnweightedDiGraph&& g, ComponentPolicy policy = ComponentPolicy::Largest);
     SimpleDiGraph(SignedDiGraph&& g);
-    SimpleDiGraph(std::string&& name, std::istream& in);
-    SimpleDiGraph(std::string&& name, const std::filesystem::path& source);
+    SimpleDiGraph(std::string&& name, std::vector<std::pair<rawID_t, rawID_t>>&& edges, ComponentPolicy policy = ComponentPolicy::Largest);
+    SimpleDiGraph(std::string&& name, std::istream& in, ComponentPolicy policy = ComponentPolicy::Largest);
+    SimpleDiGraph(std::string&& name, const std::filesystem::path& source, ComponentPolicy policy = ComponentPolicy::Largest);
+    SimpleDiGraph(std::string&& name, EdgeStream& in, ComponentPolicy policy = ComponentPolicy::Largest);
+    static SimpleDiGraph load(const std::filesystem::path& path);
+    void save(const std::filesystem::path& path) const;
     node_t nodeNum() const { return n; }
-    node_t edgeNum() const { return m; }
-    std::vector<std::vector<node_t>> InvAdjs() const;
+    offset_t edgeNum() const { return m; }
+    rawID_t originalID(node_t u) const { return originalIDs.empty() ? u : originalIDs[u]; }
+    // Reverse adjacency lists, sorted. Computed on the first call and cached, so adjs must not
+    // change afterwards.
+    const CSR& InvAdjs() const;
+    node_t inDegree(node_t u) const { return InvAdjs().degree(u); }
     Eigen::VectorXd degrVec() const;
-    Eigen::SparseMatrix<double> degrMat() const;
+    Eigen::DiagonalMatrix<double, Eigen::Dynamic> degrMat() const;
     Eigen::SparseMatrix<double> adjMat() const;
+    LaplacianOperator laplacian(LaplacianKind kind = LaplacianKind::Combinatorial) const { return LaplacianOperator(adjs, kind); }
 };
 
 struct SignedUndiGraph {
-    node_t n, m;
+    node_t n;
+    offset_t m;
     std::string name;
-    std::vector<std::vector<node_t>> posAdjs, negAdjs;
-    SignedUndiGraph(node_t n, node_t m, std::string&& name, std::vector<std::vector<node_t>>&& posAdjs, std::vector<std::vector<node_t>>&& negAdjs)
+    CSR posAdjs, negAdjs;
+    // ID in the source edge list of every node; empty for generated graphs.
+    std::vector<rawID_t> originalIDs;
+    SignedUndiGraph(node_t n, offset_t m, std::string&& name, CSR&& posAdjs, CSR&& negAdjs)
         : n(n)
         , m(m)
-        , name(name)
+        , name(std::move(name))
+        , posAdjs(std::move(posAdjs))
+        , negAdjs(std::move(negAdjs))
+    {
+    }
+    SignedUndiGraph(node_t n, offset_t m, std::string&& name, const std::vector<std::vector<node_t>>& posAdjs, const std::vector<std::vector<node_t>>& negAdjs)
+        : n(n)
+        , m(m)
+        , name(std::move(name))
         , posAdjs(posAdjs)
         , negAdjs(negAdjs)
     {
@@ -211,27 +542,57 @@ struct SignedUndiGraph {
         , name(g.name)
         , posAdjs(g.posAdjs)
         , negAdjs(g.negAdjs)
+        , originalIDs(g.originalIDs)
     {
     }
-    SignedUndiGraph(WeightedUndiGraph&& g);
-    SignedUndiGraph(std::string&& name, std::istream& in);
-    SignedUndiGraph(std::string&& name, const std::filesystem::path& source);
+    SignedUndiGraph(SignedUndiGraph&& g)
+        : n(g.n)
+        , m(g.m)
+        , name(std::move(g.name))
+        , posAdjs(std::move(g.posAdjs))
+        , negAdjs(std::move(g.negAdjs))
+        , originalIDs(std::move(g.originalIDs))
+    {
+    }
+    SignedUndiGraph& operator=(const SignedUndiGraph& g) = default;
+    SignedUndiGraph& operator=(SignedUndiGraph&& g) = default;
+    SignedUndiGraph(WeightedUndiGraph&& g, ComponentPolicy policy = ComponentPolicy::Largest);
+    SignedUndiGraph(std::string&& name, std::vector<std::tuple<rawID_t, rawID_t, weight_t>>&& edges, ComponentPolicy policy = ComponentPolicy::Largest);
+    SignedUndiGraph(std::string&& name, std::istream& in, ComponentPolicy policy = ComponentPolicy::Largest);
+    SignedUndiGraph(std::string&& name, const std::filesystem::path& source, ComponentPolicy policy = ComponentPolicy::Largest);
+    SignedUndiGraph(std::string&& name, EdgeStream& in, ComponentPolicy policy = ComponentPolicy::Largest);
+    static SignedUndiGraph load(const std::filesystem::path& path);
+    void save(const std::filesystem::path& path) const;
     node_t nodeNum() const { return n; }
-    node_t edgeNum() const { return m; }
+    offset_t edgeNum() const { return m; }
+    rawID_t originalID(node_t u) const { return originalIDs.empty() ? u : originalIDs[u]; }
     Eigen::VectorXd degrVec() const;
-    Eigen::SparseMatrix<double> degrMat() const;
+    Eigen::DiagonalMatrix<double, Eigen::Dynamic> degrMat() const;
     Eigen::SparseMatrix<double> adjMat() const;
+    LaplacianOperator laplacian(LaplacianKind kind = LaplacianKind::Combinatorial) const { return LaplacianOperator(posAdjs, negAdjs, kind); }
     SimpleUndiGraph expansion() const;
+    ExpansionView expansionView() const { return ExpansionView(*this); }
 };
 
 struct SignedDiGraph {
-    node_t n, m;
+    node_t n;
+    offset_t m;
     std::string name;
-    std::vector<std::vector<node_t>> posAdjs, negAdjs;
-    SignedDiGraph(node_t n, node_t m, std::string&& name, std::vector<std::vector<node_t>>&& posAdjs, std::vector<std::vector<node_t>>&& negAdjs)
+    CSR posAdjs, negAdjs;
+    // ID in the source edge list of every node; empty for generated graphs.
+    std::vector<rawID_t> originalIDs;
+    SignedDiGraph(node_t n, offset_t m, std::string&& name, CSR&& posAdjs, CSR&& negAdjs)
+        : n(n)
+        , m(m)
+        , name(std::move(name))
+        , posAdjs(std::move(posAdjs))
+        , negAdjs(std::move(negAdjs))
+    {
+    }
+    SignedDiGraph(node_t n, offset_t m, std::string&& name, const std::vector<std::vector<node_t>>& posAdjs, const std::vector<std::vector<node_t>>& negAdjs)
         : n(n)
         , m(m)
-        , name(name)
+        , name(std::move(name))
         , posAdjs(posAdjs)
         , negAdjs(negAdjs)
     {
@@ -242,19 +603,232 @@ struct SignedDiGraph {
         , name(g.name)
         , posAdjs(g.posAdjs)
         , negAdjs(g.negAdjs)
+        , originalIDs(g.originalIDs)
+    {
+    }
+    SignedDiGraph(SignedDiGraph&& g)
+        : n(g.n)
+        , m(g.m)
+        , name(std::move(g.name))
+        , posAdjs(std::move(g.posAdjs))
+        , negAdjs(std::move(g.negAdjs))
+        , originalIDs(std::move(g.originalIDs))
     {
     }
-    SignedDiGraph(WeightedDiGraph&& g);
-    SignedDiGraph(std::string&& name, std::istream& in);
-    SignedDiGraph(std::string&& name, const std::filesystem::path& source);
+    SignedDiGraph& operator=(const SignedDiGraph& g) = default;
+    SignedDiGraph& operator=(SignedDiGraph&& g) = default;
+    SignedDiGraph(WeightedDiGraph&& g, ComponentPolicy policy = ComponentPolicy::Largest);
+    SignedDiGraph(std::string&& name, std::vector<std::tuple<rawID_t, rawID_t, weight_t>>&& edges, ComponentPolicy policy = ComponentPolicy::Largest);
+    SignedDiGraph(std::string&& name, std::istream& in, ComponentPolicy policy = ComponentPolicy::Largest);
+    SignedDiGraph(std::string&& name, const std::filesystem::path& source, ComponentPolicy policy = ComponentPolicy::Largest);
+    SignedDiGraph(std::string&& name, EdgeStream& in, ComponentPolicy policy = ComponentPolicy::Largest);
+    static SignedDiGraph load(const std::filesystem::path& path);
+    void save(const std::filesystem::path& path) const;
     node_t nodeNum() const { return n; }
-    node_t edgeNum() const { return m; }
+    offset_t edgeNum() const { return m; }
+    rawID_t originalID(node_t u) const { return originalIDs.empty() ? u : originalIDs[u]; }
     Eigen::VectorXd degrVec() const;
-    Eigen::SparseMatrix<double> degrMat() const;
+    Eigen::DiagonalMatrix<double, Eigen::Dynamic> degrMat() const;
     Eigen::SparseMatrix<double> adjMat() const;
+    LaplacianOperator laplacian(LaplacianKind kind = LaplacianKind::Combinatorial) const { return LaplacianOperator(posAdjs, negAdjs, kind); }
     SimpleDiGraph expansion() const;
+    ExpansionView expansionView() const { return ExpansionView(*this); }
 };
 
+Components FindComponents(const UnweightedUndiGraph& g);
+Components FindComponents(const UnweightedDiGraph& g);
+Components FindComponents(const WeightedUndiGraph& g);
+Components FindComponents(const WeightedDiGraph& g);
+Components FindComponents(const SimpleUndiGraph& g);
+Components FindComponents(const SimpleDiGraph& g);
+Components FindComponents(const SignedUndiGraph& g);
+Components FindComponents(const SignedDiGraph& g);
+// The k largest components of comps = FindComponents(g) as compacted graphs named {name}_CC{i}
+// or {name}_SCC{i}, with nodes renumbered in increasing order. Raw graphs give Simple or Signed
+// graphs like their converting constructors do.
+std::vector<SimpleUndiGraph> TopComponents(const UnweightedUndiGraph& g, const Components& comps, node_t k);
+std::vector<SimpleDiGraph> TopComponents(const UnweightedDiGraph& g, const Components& comps, node_t k);
+std::vector<SignedUndiGraph> TopComponents(const WeightedUndiGraph& g, const Components& comps, node_t k);
+std::vector<SignedDiGraph> TopComponents(const WeightedDiGraph& g, const Components& comps, node_t k);
+std::vector<SimpleUndiGraph> TopComponents(const SimpleUndiGraph& g, const Components& comps, node_t k);
+std::vector<SimpleDiGraph> TopComponents(const SimpleDiGraph& g, const Components& comps, node_t k);
+std::vector<SignedUndiGraph> TopComponents(const SignedUndiGraph& g, const Components& comps, node_t k);
+std::vector<SignedDiGraph> TopComponents(const SignedDiGraph& g, const Components& comps, node_t k);
+
+// Direction of the BFS levels. Auto switches between pushing from the frontier and pulling into
+// the unvisited nodes as the frontier grows and shrinks (Beamer et al.).
+enum class BFSDirection {
+    Auto,
+    TopDown,
+    BottomUp
+};
+// Hop distances and a BFS tree from one source. The source is its own parent; nodes not
+// reached have dist and parent equal to unreached. Distances do not depend on the thread count,
+// but with several threads a node may get any parent at distance dist - 1.
+struct BFSTree {
+    static constexpr node_t unreached = std::numeric_limits<node_t>::max();
+    node_t source;
+    std::vector<node_t> dist, parent;
+    bool reached(node_t u) const { return dist[u] != unreached; }
+};
+// Level-synchronous BFS on GetThreadNum() threads. Pulling on a directed graph reads InvAdjs();
+// a directed ExpansionView transposes its arrays when it first pulls.
+BFSTree BFS(const SimpleUndiGraph& g, node_t source, BFSDirection direction = BFSDirection::Auto);
+BFSTree BFS(const SimpleDiGraph& g, node_t source, BFSDirection direction = BFSDirection::Auto);
+BFSTree BFS(const ExpansionView& g, node_t source, BFSDirection direction = BFSDirection::Auto);
+
+// Hop-distance statistics over the pairs (s, v) with v reachable from s, v != s. Nodes that reach
+// no other node have eccentricity 0.
+struct DistanceStats {
+    std::vector<node_t> eccentricity;
+    node_t diameter, radius;
+    std::uint64_t pairNum;
+    double averageDistance;
+};
+// Eccentricities of the given sources, from batches of 64 to 512 sources searched at once with
+// one bit per source; batches run in parallel on GetThreadNum() threads.
+std::vector<node_t> Eccentricities(const SimpleUndiGraph& g, const std::vector<node_t>& sources);
+std::vector<node_t> Eccentricities(const SimpleDiGraph& g, const std::vector<node_t>& sources);
+// Statistics over all sources, with the same engine.
+DistanceStats AllDistances(const SimpleUndiGraph& g);
+DistanceStats AllDistances(const SimpleDiGraph& g);
+// Exact diameter of a connected graph by iFUB: eccentricities are only computed for the farthest
+// levels from a central node, until the bound the next level could give falls below the best found.
+node_t Diameter(const SimpleUndiGraph& g);
+
+// Triangles through every node, local clustering coefficients (0 below degree 2), their mean
+// over all nodes, and transitivity, i.e. 3 * triangleNum over the number of paths of length 2.
+struct TriangleStats {
+    std::uint64_t triangleNum;
+    std::vector<std::uint64_t> triangles;
+    std::vector<double> clustering;
+    double averageClustering, transitivity;
+};
+// Every edge is oriented towards the endpoint of higher degree, and the out-lists of both ends
+// are intersected with GetIntersectionKernel() on GetThreadNum() threads.
+std::uint64_t TriangleNum(const SimpleUndiGraph& g);
+TriangleStats CountTriangles(const SimpleUndiGraph& g);
+
+// Preconditioner of LaplacianSolver. Jacobi divides by the degrees; IncompleteCholesky is Eigen's
+// factor of the grounded matrix without fill-in, applied to the columns of a batch in parallel.
+enum class LaplacianPreconditioner {
+    None,
+    Jacobi,
+    IncompleteCholesky
+};
+// Preconditioned conjugate gradients for L x = b on a connected graph, which must outlive the
+// solver. The ground node is pinned to 0, which leaves a positive definite system; right-hand
+// sides are projected to sum 0 and solutions shifted to mean 0, so that x = L^+ b. Columns are
+// solved in batches of 32 that share every pass over the adjacency lists, on GetThreadNum() threads.
+struct LaplacianSolver {
+    const CSR& adjs;
+    Eigen::VectorXd degr;
+    // The node of largest degree.
+    node_t ground;
+    LaplacianPreconditioner preconditioner;
+    // A column stops once its residual is within tolerance times its right-hand side, or after maxIterations.
+    double tolerance;
+    unsigned maxIterations;
+    Eigen::IncompleteCholesky<double> ic;
+    LaplacianSolver(const SimpleUndiGraph& g, LaplacianPreconditioner preconditioner = LaplacianPreconditioner::Jacobi, double tolerance = 1e-8, unsigned maxIterations = 10000);
+    // If iterations is given, it receives the most iterations taken by a batch.
+    Eigen::MatrixXd solve(const Eigen::MatrixXd& rhs, unsigned* iterations = nullptr) const;
+    // Effective resistance (e_u - e_v)^T L^+ (e_u - e_v), one column per pair.
+    double resistance(node_t u, node_t v) const;
+    std::vector<double> resistances(const std::vector<std::pair<node_t, node_t>>& pairs) const;
+    // Diagonal of L^+, from n solves.
+    Eigen::VectorXd pinvDiagonal() const;
+};
+// Sum of the effective resistances over unordered pairs, n tr(L^+).
+double KirchhoffIndex(const LaplacianSolver& solver);
+// Kemeny constant of the random walk, sum of d_u d_v R(u, v) over ordered pairs divided by 4m.
+double KemenyConstant(const LaplacianSolver& solver);
+
+// Johnson-Lindenstrauss sketch of all effective resistances (Spielman and Srivastava): k solves
+// against random +-1/sqrt(k) combinations of the incidence rows give every node a row z_u with
+// ||z_u - z_v||^2 within a factor 1 +- epsilon of R(u, v), with high probability once k reaches
+// dimension(n, epsilon). z takes 8nk bytes.
+struct ResistanceSketch {
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> z;
+    Eigen::VectorXd degr;
+    ResistanceSketch(const LaplacianSolver& solver, unsigned k, std::uint64_t seed);
+    // Achlioptas' bound 4 ln n / (epsilon^2 / 2 - epsilon^3 / 3).
+    static unsigned dimension(node_t n, double epsilon);
+    double resistance(node_t u, node_t v) const;
+    // Sums over all pairs in O(nk) from the sums of z_u and ||z_u||^2.
+    double kirchhoffIndex() const;
+    double kemenyConstant() const;
+};
+
+// Sums over rooted spanning forests, where a forest F has probability proportional to
+// q^|roots(F)|, divided by the number of samples. With q = 0 every sample is a uniform spanning
+// tree whose root is drawn from the stationary distribution.
+struct ForestStats {
+    std::uint64_t sampleNum;
+    // Frequency of u being a root, an unbiased estimate of q (qI + L)^-1 at (u, u).
+    std::vector<double> rootFrequency;
+    // Mean root count, estimating the trace of the same matrix.
+    double rootNum;
+    // Frequency of every arc u -> next(u) of the forest, indexed like adjs.targets. With q = 0 the
+    // arcs u -> v and v -> u together estimate R(u, v) for every edge.
+    std::vector<double> arcFrequency;
+    // Mean number of random-walk steps per sample.
+    double steps;
+    // With q = 0, the mean commute time between the root and a stationary node, halved (Wilson).
+    double kemenyConstant() const { return steps / 2; }
+};
+// Wilson's algorithm with roots: loop-erased random walks from every node in turn, stopping at u
+// with probability q / (q + d_u) or on reaching the forest. Samples run in parallel on
+// GetThreadNum() threads, each with its own next-arc array; sample i draws from a stream seeded
+// by (seed, i), so results do not depend on the thread count. q = 0 needs a connected graph.
+ForestStats SampleForests(const SimpleUndiGraph& g, double q, std::uint64_t sampleNum, std::uint64_t seed);
+
+// Walker's alias method: sample(rng) draws i with probability weights[i] / sum of weights in O(1)
+// from two outputs of rng, which must return uniform 64-bit values.
+struct AliasTable {
+    std::vector<double> prob;
+    std::vector<std::uint64_t> alias;
+    AliasTable(std::span<const double> weights);
+    template <typename RNG>
+    std::uint64_t sample(RNG& rng) const
+    {
+        const std::uint64_t i = static_cast<std::uint64_t>((static_cast<unsigned __int128>(rng()) * prob.size()) >> 64);
+        return (rng() >> 11) * 0x1p-53 < prob[i] ? i : alias[i];
+    }
+};
+// How walks move. A step picks an arc by arcWeights, indexed like adjs.targets (uniform if empty,
+// or where a node's weights sum to 0), through per-node alias tables. returnParam p and inOutParam
+// q bias it as in node2vec: by 1/p back to the previous node, 1 to its out-neighbours and 1/q
+// elsewhere, through rejection; the out-lists must then be sorted. Walks take at most length steps.
+struct WalkParams {
+    std::uint64_t length = 80;
+    std::span<const double> arcWeights;
+    double returnParam = 1, inOutParam = 1;
+    // Chance per step of jumping back to the source, which clears the previous node; the teleport
+    // probability of PersonalizedPageRank.
+    double restartProb = 0;
+};
+// Walk corpus for node2vec-style training, written in parallel straight to path. Walk i starts at
+// node i mod n, walksPerNode times over; walks stopped at a sink are padded with walkPad. Walk i
+// draws from a stream seeded by (seed, i), so the file does not depend on the thread count.
+constexpr node_t walkPad = std::numeric_limits<node_t>::max();
+void WriteWalks(const SimpleUndiGraph& g, const WalkParams& params, std::uint64_t walksPerNode, std::uint64_t seed, const std::filesystem::path& path);
+void WriteWalks(const SimpleDiGraph& g, const WalkParams& params, std::uint64_t walksPerNode, std::uint64_t seed, const std::filesystem::path& path);
+// Maps a corpus and calls f on every walk in file order, without its padding.
+void ReadWalks(const std::filesystem::path& path, const std::function<void(std::span<const node_t>)>& f);
+// Monte Carlo personalized PageRank with teleport probability params.restartProb: walks start from
+// the personalization distribution, jump back to it at sinks, and every visit counts.
+std::vector<double> PersonalizedPageRank(const SimpleUndiGraph& g, const AliasTable& personalization, const WalkParams& params, std::uint64_t walkNum, std::uint64_t seed);
+std::vector<double> PersonalizedPageRank(const SimpleDiGraph& g, const AliasTable& personalization, const WalkParams& params, std::uint64_t walkNum, std::uint64_t seed);
+// Mean steps from every source to target over walksPerSource walks; restartProb is ignored. A walk
+// that does not arrive within params.length steps counts as length, so a short length biases
+// the estimate down.
+std::vector<double> HittingTimes(const SimpleUndiGraph& g, const std::vector<node_t>& sources, node_t target, const WalkParams& params, std::uint64_t walksPerSource, std::uint64_t seed);
+std::vector<double> HittingTimes(const SimpleDiGraph& g, const std::vector<node_t>& sources, node_t target, const WalkParams& params, std::uint64_t walksPerSource, std::uint64_t seed);
+// H(u, v) + H(v, u), which is 2m R(u, v) for uniform steps on an undirected graph.
+double CommuteTime(const SimpleUndiGraph& g, node_t u, node_t v, const WalkParams& params, std::uint64_t walkNum, std::uint64_t seed);
+double CommuteTime(const SimpleDiGraph& g, node_t u, node_t v, const WalkParams& params, std::uint64_t walkNum, std::uint64_t seed);
+
 std::ostream& operator<<(std::ostream& os, const UnweightedUndiGraph& g);
 std::ostream& operator<<(std::ostream& os, const WeightedUndiGraph& g);
 std::ostream& operator<<(std::ostream& os, const SimpleUndiGraph& g);
@@ -264,14 +838,80 @@ std::ostream& operator<<(std::ostream& os, const SimpleDiGraph& g);
 std::ostream& operator<<(std::ostream& os, const SignedUndiGraph& g);
 std::ostream& operator<<(std::ostream& os, const SignedDiGraph& g);
 
+// Version of the format written by save() on the compacted graph types.
+constexpr std::uint32_t snapshotVersion = 4;
+
+template <typename T>
+constexpr const char* graphTypeName = nullptr;
+template <>
+inline constexpr const char* graphTypeName<SimpleUndiGraph> = "SimpleUndiGraph";
+template <>
+inline constexpr const char* graphTypeName<SimpleDiGraph> = "SimpleDiGraph";
+template <>
+inline constexpr const char* graphTypeName<SignedUndiGraph> = "SignedUndiGraph";
+template <>
+inline constexpr const char* graphTypeName<SignedDiGraph> = "SignedDiGraph";
+
+// Processed-dataset cache. Compacted graphs loaded through LoadKonect/LoadSnap are kept as
+// snapshots under GetCacheDir(), keyed by dataset source, dataset name and graph type.
+// The default directory is $GKIT_CACHE_DIR, else $XDG_CACHE_HOME/graphkit, else ~/.cache/graphkit.
+std::filesystem::path GetCacheDir();
+void SetCacheDir(const std::filesystem::path& dir);
+std::filesystem::path GetCachePath(const std::string& source, const std::string& key, const std::string& typeName);
+// Exclusive lock on a cache entry across processes, held while the entry is built.
+struct CacheLock {
+    int fd;
+    CacheLock(const std::filesystem::path& cachePath);
+    CacheLock(const CacheLock&) = delete;
+    ~CacheLock();
+};
+// Writes the entry through save into a temporary file, then renames it into place.
+void StoreCache(const std::filesystem::path& cachePath, const std::function<void(const std::filesystem::path&)>& save);
+
+template <typename T, typename F>
+T LoadCached(const std::string& source, const std::string& key, std::string&& name, F&& build)
+{
+    if constexpr (graphTypeName<T> != nullptr) {
+        const std::filesystem::path cachePath = GetCachePath(source, key, graphTypeName<T>);
+        if (!std::filesystem::exists(cachePath)) {
+            CacheLock lock(cachePath);
+            if (!std::filesystem::exists(cachePath)) {
+                T g = build(std::move(name));
+                StoreCache(cachePath, [&g](const std::filesystem::path& path) { g.save(path); });
+                return g;
+            }
+        }
+        T g = T::load(cachePath);
+        g.name = std::move(name);
+        return g;
+    } else
+        return build(std::move(name));
+}
+
+// Downloads url to path, over several ranged connections when the server allows it. An interrupted
+// download resumes from path.part on the next call; path only appears once the size and verify() pass.
+void DownloadFile(const std::string& url, const std::filesystem::path& path, const std::function<bool(const std::filesystem::path&)>& verify = {});
+
 std::filesystem::path GetKonectPath(const std::string& internalName);
 std::filesystem::path GetSnapPath(const std::string& url);
+// Extracted edge list of a dataset if it is already on disk, otherwise an empty path.
+std::filesystem::path FindKonectPath(const std::string& internalName);
+std::filesystem::path FindSnapPath(const std::string& url);
+// Edge list of a dataset decompressed on a background thread straight from its archive,
+// downloading the archive first if needed. Nothing is extracted to disk.
+std::unique_ptr<EdgeStream> OpenKonectStream(const std::string& internalName);
+std::unique_ptr<EdgeStream> OpenSnapStream(const std::string& url);
 
 template <typename T>
 T LoadKonect(std::string& internalName, std::string&& name)
 {
-    const std::filesystem::path source = GetKonectPath(internalName);
-    return T(std::move(name), source);
+    return LoadCached<T>("konect", internalName, std::move(name), [&internalName](std::string&& name) {
+        const std::filesystem::path source = FindKonectPath(internalName);
+        if (!source.empty())
+            return T(std::move(name), source);
+        std::unique_ptr<EdgeStream> in = OpenKonectStream(internalName);
+        return T(std::move(name), *in);
+    });
 }
 template <typename T>
 T LoadKonect(std::string& internalName)
@@ -282,8 +922,13 @@ T LoadKonect(std::string& internalName)
 template <typename T>
 T LoadSnap(std::string& url, std::string&& name)
 {
-    const std::filesystem::path source = GetSnapPath(url);
-    return T(std::move(name), source);
+    return LoadCached<T>("snap", std::filesystem::path(url).stem().string(), std::move(name), [&url](std::string&& name) {
+        const std::filesystem::path source = FindSnapPath(url);
+        if (!source.empty())
+            return T(std::move(name), source);
+        std::unique_ptr<EdgeStream> in = OpenSnapStream(url);
+        return T(std::move(name), *in);
+    });
 }
 
 SimpleUndiGraph LoadPseudoExt(std::uint64_t m, std::uint64_t g);
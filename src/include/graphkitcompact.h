@@ -0,0 +1,173 @@
+#pragma once
+#include "graphkit.h"
+#include "graphkitparser.h"
+#include "graphkitutils.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace gkit {
+// Bulk counterparts of addEdge and of the relabeling done by the compacted-graph
+// constructors, working on flat edge buffers instead of ordered containers.
+
+// Sorts keys with a parallel LSD radix sort on GetThreadNum() threads.
+void RadixSort(std::vector<rawID_t>& keys);
+
+// Relabels sparse node IDs to 0..n-1 in increasing order; ids[i] is the original ID of node i.
+// IDs spanning less than lookupSpread times as many values as there are nodes are looked up
+// in a direct array. Sparser IDs are split into about n buckets by their high bits, and a
+// lookup only searches its own bucket.
+struct IDMap {
+    static constexpr std::uint64_t lookupSpread = 4;
+    std::vector<rawID_t> ids;
+    std::vector<node_t> lookup;
+    std::vector<node_t> buckets;
+    unsigned bucketShift = 0;
+    // nodeIDs may be unsorted and repeated, unless sorted says they are strictly increasing.
+    IDMap(std::vector<rawID_t>&& nodeIDs, bool sorted = false);
+    node_t size() const { return ids.size(); }
+    node_t operator[](rawID_t u) const
+    {
+        if (!lookup.empty())
+            return lookup[u - ids.front()];
+        const std::uint64_t b = (u - ids.front()) >> bucketShift;
+        return std::lower_bound(ids.begin() + buckets[b], ids.begin() + buckets[b + 1], u) - ids.begin();
+    }
+};
+
+// Drops self-loops and repeated edges, keeping the first occurrence like addEdge does.
+// Undirected edges are stored with u < v. The buffer ends up sorted by (u, v).
+template <bool Weighted>
+void CanonicalizeEdges(RawEdgeBuffer<Weighted>& raw, bool directed);
+
+// Moves raw into edges, replacing every endpoint by its rank among the distinct endpoints, which
+// are returned in increasing order. The ranks are checked to fit in node_t before narrowing.
+template <bool Weighted>
+std::vector<rawID_t> DensifyEdges(RawEdgeBuffer<Weighted>& raw, EdgeBuffer<Weighted>& edges);
+
+// Keeps the edges whose endpoints are both kept and renumbers the kept nodes in increasing order.
+// ids, the original IDs of the nodes, loses the dropped nodes alike.
+template <bool Weighted>
+void FilterEdges(EdgeBuffer<Weighted>& edges, const std::vector<bool>& keep, std::vector<rawID_t>& ids);
+
+// Reverses every edge on GetThreadNum() threads; the lists of the result are sorted.
+CSR Transpose(const CSR& adjs);
+
+// Intersects sorted lists of distinct nodes and returns the number of common elements. An emitting
+// function also writes them in increasing order to out, which needs room for the shorter list.
+using IntersectFunction = std::uint64_t (*)(const node_t* a, std::uint64_t aSize, const node_t* b, std::uint64_t bSize, node_t* out);
+IntersectFunction GetIntersectFunction(IntersectionKernel kernel, bool emit);
+
+// Counter-based hashing behind the weight fillers and the random sketches. The seed is mixed
+// once so that nearby seeds give unrelated streams.
+inline std::uint64_t SplitMix64(std::uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+inline std::uint64_t EdgeHash(std::uint64_t key, std::uint64_t i) { return SplitMix64(key ^ SplitMix64(i)); }
+// SplitMix64 stream, seeded per sample or walk so that results do not depend on the thread count.
+struct StreamRNG {
+    std::uint64_t state;
+    std::uint64_t operator()() { return SplitMix64(state++); }
+    // Uniform in [0, bound).
+    std::uint64_t below(std::uint64_t bound) { return static_cast<std::uint64_t>((static_cast<unsigned __int128>((*this)()) * bound) >> 64); }
+    // Uniform in [0, 1).
+    double uniform() { return ((*this)() >> 11) * 0x1p-53; }
+};
+
+// Fills a CSR whose list sizes degr are known up front; add(u, v) appends v to the list of u.
+// Terminates if the lists do not fit in offset_t.
+struct CSRFiller {
+    CSR& csr;
+    std::vector<offset_t> next;
+    CSRFiller(CSR& csr, std::vector<node_t>&& degr);
+    void add(node_t u, node_t v) { csr.targets[next[u]++] = v; }
+};
+
+// Numbers the components given by a labeling of dense nodes in the order of Components.
+Components RankLabels(const std::vector<node_t>& label);
+// Marks the nodes of the largest component of a labeling.
+std::vector<bool> LargestLabel(const std::vector<node_t>& label);
+// Union of two adjacency arrays over the same nodes, e.g. the positive and negative edges of a signed graph.
+CSR MergeCSR(const CSR& adjs1, const CSR& adjs2);
+// One array per component c < k and per input array, keeping the lists of the nodes of c
+// restricted to c. Nodes are renumbered in increasing order, so sorted lists stay sorted.
+std::vector<std::vector<CSR>> SplitComponents(const Components& comps, node_t k, std::initializer_list<const CSR*> adjs);
+
+// Lock-free union-find on dense IDs. A root is only ever hooked under a smaller root
+// through compare-and-swap, so concurrent unions cannot form cycles and find() needs no locks.
+struct ConcurrentDSU {
+    static constexpr std::uint64_t blockSize = 1 << 16;
+    std::unique_ptr<std::atomic<node_t>[]> parent;
+    node_t n;
+    ConcurrentDSU(node_t n)
+        : parent(new std::atomic<node_t>[n])
+        , n(n)
+    {
+        ParallelFor(GetThreadNum(), 0, n, blockSize, [this](std::uint64_t u) { parent[u].store(u, std::memory_order_relaxed); });
+    }
+    // Path halving; a failed compare-and-swap only means another thread already shortened the path.
+    node_t find(node_t u)
+    {
+        while (true) {
+            node_t p = parent[u].load(std::memory_order_relaxed);
+            if (p == u)
+                return u;
+            const node_t gp = parent[p].load(std::memory_order_relaxed);
+            if (gp != p)
+                parent[u].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+            u = gp;
+        }
+    }
+    void setUnion(node_t u, node_t v)
+    {
+        while (true) {
+            u = find(u), v = find(v);
+            if (u == v)
+                return;
+            if (u < v)
+                std::swap(u, v);
+            node_t expected = u;
+            if (parent[u].compare_exchange_strong(expected, v, std::memory_order_relaxed))
+                return;
+        }
+    }
+    // Calls unionAt(i) for every i < size on all threads.
+    template <typename F>
+    void unionAll(std::uint64_t size, F&& unionAt)
+    {
+        const std::uint64_t blockNum = (size + blockSize - 1) / blockSize;
+        std::mutex spinnerMutex;
+        TickSpinner spinner("LCC: Performing setUnion...", size);
+        ParallelFor(GetThreadNum(), 0, blockNum, 1, [&](std::uint64_t b) {
+            const std::uint64_t lo = b * blockSize, hi = std::min<std::uint64_t>(lo + blockSize, size);
+            for (std::uint64_t i = lo; i < hi; i++)
+                unionAt(i);
+            std::lock_guard<std::mutex> lock(spinnerMutex);
+            spinner.tick(hi - lo);
+        });
+        spinner.markAsCompleted();
+    }
+    template <typename Edges>
+    void unionEdges(const Edges& edges)
+    {
+        unionAll(edges.size(), [&](std::uint64_t i) { setUnion(std::get<0>(edges[i]), std::get<1>(edges[i])); });
+    }
+    // The root of every node, which is the smallest node of its component.
+    std::vector<node_t> labels()
+    {
+        std::vector<node_t> root(n);
+        ParallelFor(GetThreadNum(), 0, n, blockSize, [&](std::uint64_t u) { root[u] = find(u); });
+        return root;
+    }
+};
+}
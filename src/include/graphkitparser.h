@@ -0,0 +1,240 @@
+#pragma once
+#include "graphkit.h"
+#include "graphkitutils.h"
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <ios>
+#include <iostream>
+#include <istream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace gkit {
+// Read-only memory mapping of a whole file. An empty file maps to an empty view.
+struct MappedFile {
+    const char* data;
+    std::size_t size;
+    MappedFile(const std::filesystem::path& path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+    std::string_view view() const { return { data, size }; }
+};
+
+// Terminates when count does not fit in T, one of the index types chosen at build time.
+template <typename T>
+inline void CheckIndexRange(std::uint64_t count, const char* what)
+{
+    if (count > std::numeric_limits<T>::max()) {
+        std::string errStr = std::format("{} {} does not fit in {}-bit indices, rebuild without GKIT_NODE32/GKIT_OFFSET32\n", what, count, sizeof(T) * 8);
+        std::cerr << errStr;
+        std::terminate();
+    }
+}
+
+inline bool IsBlank(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+
+template <typename T>
+inline bool ParseField(const char*& p, const char* end, T& val)
+{
+    while (p != end && IsBlank(*p))
+        p++;
+    if (p != end && *p == '+')
+        p++;
+    auto [ptr, ec] = std::from_chars(p, end, val);
+    if (ec == std::errc::result_out_of_range) {
+        std::string errStr = std::format("Edge list value {} does not fit in {}-bit integers\n", std::string_view(p, ptr), sizeof(T) * 8);
+        std::cerr << errStr;
+        std::terminate();
+    }
+    if (ec != std::errc())
+        return false;
+    p = ptr;
+    return true;
+}
+
+// Parses one line (without its trailing '\n') of a SNAP/KONECT edge list, reading node IDs as ID.
+// Lines starting with '#' or '%' are comments; lines missing a field are skipped.
+template <bool Weighted, typename ID, typename F>
+inline void ParseEdgeLine(const char* p, const char* end, F& f)
+{
+    if (p == end || *p == '#' || *p == '%')
+        return;
+    ID u, v;
+    if (!ParseField(p, end, u) || !ParseField(p, end, v))
+        return;
+    if constexpr (Weighted) {
+        weight_t w;
+        if (!ParseField(p, end, w))
+            return;
+        f(u, v, w);
+    } else
+        f(u, v);
+}
+
+// Calls f on every edge of buf, including a last line without a trailing '\n'.
+template <bool Weighted, typename ID, typename F>
+void ParseEdgeList(std::string_view buf, F&& f)
+{
+    const char *p = buf.data(), *end = p + buf.size();
+    while (p != end) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (eol == nullptr)
+            eol = end;
+        ParseEdgeLine<Weighted, ID>(p, eol, f);
+        p = eol == end ? end : eol + 1;
+    }
+}
+
+// Incremental edge list parser for input that arrives in arbitrary chunks.
+// A line split across chunks is carried over until its '\n' is seen.
+template <bool Weighted, typename ID>
+struct EdgeListParser {
+    std::string carry;
+    template <typename F>
+    void feed(std::string_view chunk, F&& f)
+    {
+        if (!carry.empty()) {
+            std::size_t eol = chunk.find('\n');
+            if (eol == std::string_view::npos) {
+                carry.append(chunk);
+                return;
+            }
+            carry.append(chunk.substr(0, eol));
+            ParseEdgeList<Weighted, ID>(carry, f);
+            carry.clear();
+            chunk.remove_prefix(eol + 1);
+        }
+        std::size_t last = chunk.rfind('\n');
+        if (last == std::string_view::npos) {
+            carry.assign(chunk);
+            return;
+        }
+        ParseEdgeList<Weighted, ID>(chunk.substr(0, last), f);
+        carry.assign(chunk.substr(last + 1));
+    }
+    template <typename F>
+    void finish(F&& f)
+    {
+        ParseEdgeList<Weighted, ID>(carry, f);
+        carry.clear();
+    }
+};
+
+template <bool Weighted, typename ID = node_t>
+using EdgeTuple = std::conditional_t<Weighted, std::tuple<ID, ID, weight_t>, std::pair<ID, ID>>;
+template <bool Weighted, typename ID = node_t>
+using EdgeBuffer = std::vector<EdgeTuple<Weighted, ID>>;
+// Edges as read from a file, before DensifyEdges narrows them to node_t.
+template <bool Weighted>
+using RawEdgeBuffer = EdgeBuffer<Weighted, rawID_t>;
+
+// Splits buf into at most parts pieces, each ending right after a '\n' or at the end of buf.
+std::vector<std::string_view> SplitLines(std::string_view buf, std::size_t parts);
+
+// Parses buf on threadNum threads. The i-th buffer holds the edges of the i-th piece of buf,
+// so visiting the buffers in order visits the edges in file order.
+template <bool Weighted, typename ID>
+std::vector<EdgeBuffer<Weighted, ID>> ParseEdgeListParallel(std::string_view buf, unsigned threadNum);
+
+std::streamsize GetStreamSize(std::istream& in);
+
+// Streams are consumed in large blocks instead of line by line, and mapped files
+// are handed to the parser in blocks only so that the spinner can advance.
+constexpr std::size_t readBlockSize = 1 << 20;
+constexpr std::size_t mapBlockSize = 1 << 26;
+
+// ReadEdgeList reads node IDs as ID: node_t for the raw graph types, which keep the IDs of the
+// file, and rawID_t for the edge buffers of the compacted types.
+template <bool Weighted, typename ID = node_t, typename F>
+void ReadEdgeList(std::istream& in, SetSpinner& spinner, F&& f)
+{
+    EdgeListParser<Weighted, ID> parser;
+    std::string buf(readBlockSize, '\0');
+    std::uint64_t readBytes = 0;
+    while (in.read(buf.data(), buf.size()) || in.gcount() > 0) {
+        parser.feed(std::string_view(buf.data(), in.gcount()), f);
+        readBytes += in.gcount();
+        spinner.setProgress(readBytes);
+    }
+    parser.finish(f);
+}
+// With several threads, the file is parsed in rounds of mapBlockSize bytes per thread:
+// each round is split at line boundaries, parsed into per-thread buffers in parallel,
+// and then handed to f in file order, so the graph is the same as with a single thread.
+template <bool Weighted, typename ID = node_t, typename F>
+void ReadEdgeList(const MappedFile& file, SetSpinner& spinner, F&& f)
+{
+    const std::string_view buf = file.view();
+    const unsigned threadNum = GetThreadNum();
+    if (threadNum > 1) {
+        for (std::size_t offset = 0; offset < buf.size();) {
+            std::size_t roundEnd = buf.find('\n', std::min(offset + threadNum * mapBlockSize, buf.size()) - 1);
+            roundEnd = roundEnd == std::string_view::npos ? buf.size() : roundEnd + 1;
+            for (const EdgeBuffer<Weighted, ID>& edges : ParseEdgeListParallel<Weighted, ID>(buf.substr(offset, roundEnd - offset), threadNum))
+                for (const EdgeTuple<Weighted, ID>& e : edges)
+                    std::apply(f, e);
+            offset = roundEnd;
+            spinner.setProgress(offset);
+        }
+        return;
+    }
+    EdgeListParser<Weighted, ID> parser;
+    for (std::size_t offset = 0; offset < buf.size(); offset += mapBlockSize) {
+        parser.feed(buf.substr(offset, mapBlockSize), f);
+        spinner.setProgress(std::min(offset + mapBlockSize, buf.size()));
+    }
+    parser.finish(f);
+}
+
+template <bool Weighted, typename ID = node_t, typename F>
+void ReadEdgeList(EdgeStream& in, SetSpinner& spinner, F&& f)
+{
+    EdgeListParser<Weighted, ID> parser;
+    for (std::string_view chunk; !(chunk = in.next()).empty();) {
+        parser.feed(chunk, f);
+        spinner.setProgress(in.position());
+    }
+    parser.finish(f);
+}
+
+// Reads every edge into a buffer, as raw IDs unless ID says otherwise.
+template <bool Weighted, typename ID = rawID_t>
+EdgeBuffer<Weighted, ID> ReadEdgeBuffer(EdgeStream& in, const std::string& desc)
+{
+    EdgeBuffer<Weighted, ID> edges;
+    SetSpinner spinner(desc, in.size());
+    ReadEdgeList<Weighted, ID>(in, spinner, [&edges](auto... fields) { edges.emplace_back(fields...); });
+    spinner.markAsCompleted();
+    return edges;
+}
+template <bool Weighted, typename ID = rawID_t>
+EdgeBuffer<Weighted, ID> ReadEdgeBuffer(std::istream& in, const std::string& desc)
+{
+    EdgeBuffer<Weighted, ID> edges;
+    SetSpinner spinner(desc, GetStreamSize(in));
+    ReadEdgeList<Weighted, ID>(in, spinner, [&edges](auto... fields) { edges.emplace_back(fields...); });
+    spinner.markAsCompleted();
+    return edges;
+}
+template <bool Weighted, typename ID = rawID_t>
+EdgeBuffer<Weighted, ID> ReadEdgeBuffer(const std::filesystem::path& source, const std::string& desc)
+{
+    EdgeBuffer<Weighted, ID> edges;
+    MappedFile file(source);
+    SetSpinner spinner(desc, file.size);
+    ReadEdgeList<Weighted, ID>(file, spinner, [&edges](auto... fields) { edges.emplace_back(fields...); });
+    spinner.markAsCompleted();
+    return edges;
+}
+}
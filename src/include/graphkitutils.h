@@ -1,7 +1,14 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <indicators/progress_spinner.hpp>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 struct SetSpinner {
     indicators::ProgressSpinner spinner;
@@ -36,4 +43,94 @@ struct UnknownSpinner {
         spinner.set_progress(100);
         spinner.mark_as_completed();
     }
-};
\ No newline at end of file
+};
+
+// Runs f(t) for every t in [0, threadNum), each on its own thread; t = 0 runs on the caller.
+template <typename F>
+void ParallelRun(unsigned threadNum, F&& f)
+{
+    std::vector<std::thread> threads;
+    threads.reserve(threadNum);
+    for (unsigned t = 1; t < threadNum; t++)
+        threads.emplace_back([&f, t]() { f(t); });
+    f(0u);
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+// Runs f(i) for every i in [begin, end) on threadNum threads, handing out blocks of grain indices on demand.
+template <typename F>
+void ParallelFor(unsigned threadNum, std::uint64_t begin, std::uint64_t end, std::uint64_t grain, F&& f)
+{
+    if (begin >= end)
+        return;
+    grain = std::max<std::uint64_t>(grain, 1);
+    if (threadNum <= 1 || end - begin <= grain) {
+        for (std::uint64_t i = begin; i < end; i++)
+            f(i);
+        return;
+    }
+    std::atomic<std::uint64_t> next(begin);
+    const std::uint64_t blockNum = (end - begin + grain - 1) / grain;
+    ParallelRun(static_cast<unsigned>(std::min<std::uint64_t>(threadNum, blockNum)), [&](unsigned) {
+        for (std::uint64_t lo; (lo = next.fetch_add(grain, std::memory_order_relaxed)) < end;) {
+            const std::uint64_t hi = std::min(lo + grain, end);
+            for (std::uint64_t i = lo; i < hi; i++)
+                f(i);
+        }
+    });
+}
+
+// The threads of one ParallelRun going through a loop of steps together, for loops whose steps are
+// too short to pay for new threads each. Every thread makes the same calls in the same order, and
+// every call ends at a barrier, so a step sees the results of the ones before it.
+struct ParallelTeam {
+    unsigned threadNum;
+    std::atomic<std::uint64_t> next;
+    std::mutex mtx;
+    std::condition_variable cv;
+    unsigned arrived;
+    std::uint64_t generation;
+    ParallelTeam(unsigned threadNum)
+        : threadNum(std::max(threadNum, 1u))
+        , next(0)
+        , arrived(0)
+        , generation(0)
+    {
+    }
+    // Waits for the whole team, then resets the counter of forEach for the next step.
+    void sync()
+    {
+        std::unique_lock lock(mtx);
+        const std::uint64_t gen = generation;
+        if (++arrived == threadNum) {
+            arrived = 0, generation++;
+            next.store(0, std::memory_order_relaxed);
+            cv.notify_all();
+        } else
+            cv.wait(lock, [this, gen]() { return generation != gen; });
+    }
+    // Runs f(t) on every thread of the team, t = 0 on the caller.
+    template <typename F>
+    void run(F&& f) { ParallelRun(threadNum, f); }
+    // Runs f(i) for every i in [begin, end) on the team, handing out blocks of grain indices like ParallelFor.
+    template <typename F>
+    void forEach(std::uint64_t begin, std::uint64_t end, std::uint64_t grain, F&& f)
+    {
+        grain = std::max<std::uint64_t>(grain, 1);
+        for (std::uint64_t lo; begin < end && (lo = begin + next.fetch_add(grain, std::memory_order_relaxed)) < end;) {
+            const std::uint64_t hi = std::min(lo + grain, end);
+            for (std::uint64_t i = lo; i < hi; i++)
+                f(i);
+        }
+        sync();
+    }
+    // Runs f() on thread 0 while the others wait.
+    template <typename F>
+    void serial(unsigned t, F&& f)
+    {
+        if (t == 0)
+            f();
+        sync();
+    }
+};
@@ -1,22 +1,12 @@
 #include "graphkit.h"
+#include "graphkitparser.h"
 #include "graphkitutils.h"
+#include <cstddef>
 #include <format>
-#include <fstream>
-#include <ios>
-#include <iosfwd>
 #include <string>
+#include <vector>
 
 namespace gkit {
-std::streamsize GetStreamSize(std::istream& in)
-{
-    std::streampos begin_pos = in.tellg();
-    in.seekg(0, std::ios::end);
-    std::streampos end_pos = in.tellg();
-    std::streamsize file_size = end_pos - begin_pos;
-    in.seekg(0, std::ios::beg);
-    return file_size;
-}
-
 void UnweightedUndiGraph::addNode(node_t u) { nodes.insert(u); }
 void WeightedUndiGraph::addNode(node_t u) { nodes.insert(u); }
 void UnweightedDiGraph::addNode(node_t u)
@@ -69,104 +59,38 @@ void WeightedDiGraph::addEdge(node_t u, node_t v, weight_t w)
 
 void UnweightedUndiGraph::Init(std::istream& in)
 {
-    std::streamsize file_size = GetStreamSize(in);
-    std::string line;
-    int prev_progress = 0;
-    SetSpinner spinner(std::format("Reading UnweightedUndiGraph {}", name), file_size);
-    while (std::getline(in, line)) {
-        if (line.starts_with('#') || line.starts_with('%'))
-            continue;
-        node_t u, v;
-        std::istringstream iss(line);
-        iss >> u >> v;
-        addEdge(u, v);
-        spinner.setProgress(in.tellg());
-    }
+    SetSpinner spinner(std::format("Reading UnweightedUndiGraph {}", name), GetStreamSize(in));
+    ReadEdgeList<false>(in, spinner, [this](node_t u, node_t v) { addEdge(u, v); });
     spinner.markAsCompleted();
 }
 void WeightedUndiGraph::Init(std::istream& in)
 {
-    std::streamsize file_size = GetStreamSize(in);
-    std::string line;
-    int prev_progress = 0;
-    SetSpinner spinner(std::format("Reading WeightedUndiGraph {}", name), file_size);
-    while (std::getline(in, line)) {
-        if (line.starts_with('#') || line.starts_with('%'))
-            continue;
-        node_t u, v, w;
-        std::istringstream iss(line);
-        iss >> u >> v >> w;
-        addEdge(u, v, w);
-        spinner.setProgress(in.tellg());
-    }
+    SetSpinner spinner(std::format("Reading WeightedUndiGraph {}", name), GetStreamSize(in));
+    ReadEdgeList<true>(in, spinner, [this](node_t u, node_t v, weight_t w) { addEdge(u, v, w); });
     spinner.markAsCompleted();
 }
 void WeightedUndiGraph::Init(std::istream& in, std::function<weight_t()>&& generator)
 {
-    std::streamsize file_size = GetStreamSize(in);
-    std::string line;
-    int prev_progress = 0;
-    SetSpinner spinner(std::format("Reading WeightedUndiGraph {}", name), file_size);
-    while (std::getline(in, line)) {
-        if (line.starts_with('#') || line.starts_with('%'))
-            continue;
-        node_t u, v;
-        std::istringstream iss(line);
-        iss >> u >> v;
-        addEdge(u, v, generator());
-        spinner.setProgress(in.tellg());
-    }
+    SetSpinner spinner(std::format("Reading WeightedUndiGraph {}", name), GetStreamSize(in));
+    ReadEdgeList<false>(in, spinner, [this, &generator](node_t u, node_t v) { addEdge(u, v, generator()); });
     spinner.markAsCompleted();
 }
 void UnweightedDiGraph::Init(std::istream& in)
 {
-    std::streamsize file_size = GetStreamSize(in);
-    std::string line;
-    int prev_progress = 0;
-    SetSpinner spinner(std::format("Reading UnweightedDiGraph {}", name), file_size);
-    while (std::getline(in, line)) {
-        if (line.starts_with('#') || line.starts_with('%'))
-            continue;
-        node_t u, v;
-        std::istringstream iss(line);
-        iss >> u >> v;
-        addEdge(u, v);
-        spinner.setProgress(in.tellg());
-    }
+    SetSpinner spinner(std::format("Reading UnweightedDiGraph {}", name), GetStreamSize(in));
+    ReadEdgeList<false>(in, spinner, [this](node_t u, node_t v) { addEdge(u, v); });
     spinner.markAsCompleted();
 }
 void WeightedDiGraph::Init(std::istream& in)
 {
-    std::streamsize file_size = GetStreamSize(in);
-    std::string line;
-    int prev_progress = 0;
-    SetSpinner spinner(std::format("Reading WeightedDiGraph {}", name), file_size);
-    while (std::getline(in, line)) {
-        if (line.starts_with('#') || line.starts_with('%'))
-            continue;
-        node_t u, v, w;
-        std::istringstream iss(line);
-        iss >> u >> v >> w;
-        addEdge(u, v, w);
-        spinner.setProgress(in.tellg());
-    }
+    SetSpinner spinner(std::format("Reading WeightedDiGraph {}", name), GetStreamSize(in));
+    ReadEdgeList<true>(in, spinner, [this](node_t u, node_t v, weight_t w) { addEdge(u, v, w); });
     spinner.markAsCompleted();
 }
 void WeightedDiGraph::Init(std::istream& in, std::function<weight_t()>&& generator)
 {
-    std::streamsize file_size = GetStreamSize(in);
-    std::string line;
-    int prev_progress = 0;
-    SetSpinner spinner(std::format("Reading WeightedDiGraph {}", name), file_size);
-    while (std::getline(in, line)) {
-        if (line.starts_with('#') || line.starts_with('%'))
-            continue;
-        node_t u, v;
-        std::istringstream iss(line);
-        iss >> u >> v;
-        addEdge(u, v, generator());
-        spinner.setProgress(in.tellg());
-    }
+    SetSpinner spinner(std::format("Reading WeightedDiGraph {}", name), GetStreamSize(in));
+    ReadEdgeList<false>(in, spinner, [this, &generator](node_t u, node_t v) { addEdge(u, v, generator()); });
     spinner.markAsCompleted();
 }
 
@@ -204,37 +128,118 @@ WeightedDiGraph::WeightedDiGraph(std::string&& name, std::istream& in, std::func
 UnweightedUndiGraph::UnweightedUndiGraph(std::string&& name, const std::filesystem::path& source)
     : name(name)
 {
-    std::ifstream fin(source);
-    Init(fin);
+    MappedFile file(source);
+    SetSpinner spinner(std::format("Reading UnweightedUndiGraph {}", this->name), file.size);
+    ReadEdgeList<false>(file, spinner, [this](node_t u, node_t v) { addEdge(u, v); });
+    spinner.markAsCompleted();
 }
 WeightedUndiGraph::WeightedUndiGraph(std::string&& name, const std::filesystem::path& source)
     : name(name)
 {
-    std::ifstream fin(source);
-    Init(fin);
+    MappedFile file(source);
+    SetSpinner spinner(std::format("Reading WeightedUndiGraph {}", this->name), file.size);
+    ReadEdgeList<true>(file, spinner, [this](node_t u, node_t v, weight_t w) { addEdge(u, v, w); });
+    spinner.markAsCompleted();
 }
 WeightedUndiGraph::WeightedUndiGraph(std::string&& name, const std::filesystem::path& source, std::function<weight_t()>&& generator)
     : name(name)
 {
-    std::ifstream fin(source);
-    Init(fin, std::move(generator));
+    MappedFile file(source);
+    SetSpinner spinner(std::format("Reading WeightedUndiGraph {}", this->name), file.size);
+    ReadEdgeList<false>(file, spinner, [this, &generator](node_t u, node_t v) { addEdge(u, v, generator()); });
+    spinner.markAsCompleted();
 }
 UnweightedDiGraph::UnweightedDiGraph(std::string&& name, const std::filesystem::path& source)
     : name(name)
 {
-    std::ifstream fin(source);
-    Init(fin);
+    MappedFile file(source);
+    SetSpinner spinner(std::format("Reading UnweightedDiGraph {}", this->name), file.size);
+    ReadEdgeList<false>(file, spinner, [this](node_t u, node_t v) { addEdge(u, v); });
+    spinner.markAsCompleted();
 }
 WeightedDiGraph::WeightedDiGraph(std::string&& name, const std::filesystem::path& source)
     : name(name)
 {
-    std::ifstream fin(source);
-    Init(fin);
+    MappedFile file(source);
+    SetSpinner spinner(std::format("Reading WeightedDiGraph {}", this->name), file.size);
+    ReadEdgeList<true>(file, spinner, [this](node_t u, node_t v, weight_t w) { addEdge(u, v, w); });
+    spinner.markAsCompleted();
 }
 WeightedDiGraph::WeightedDiGraph(std::string&& name, const std::filesystem::path& source, std::function<weight_t()>&& generator)
     : name(name)
 {
-    std::ifstream fin(source);
-    Init(fin, std::move(generator));
+    MappedFile file(source);
+    SetSpinner spinner(std::format("Reading WeightedDiGraph {}", this->name), file.size);
+    ReadEdgeList<false>(file, spinner, [this, &generator](node_t u, node_t v) { addEdge(u, v, generator()); });
+    spinner.markAsCompleted();
+}
+
+UnweightedUndiGraph::UnweightedUndiGraph(std::string&& name, EdgeStream& in)
+    : name(name)
+{
+    SetSpinner spinner(std::format("Reading UnweightedUndiGraph {}", this->name), in.size());
+    ReadEdgeList<false>(in, spinner, [this](node_t u, node_t v) { addEdge(u, v); });
+    spinner.markAsCompleted();
+}
+WeightedUndiGraph::WeightedUndiGraph(std::string&& name, EdgeStream& in)
+    : name(name)
+{
+    SetSpinner spinner(std::format("Reading WeightedUndiGraph {}", this->name), in.size());
+    ReadEdgeList<true>(in, spinner, [this](node_t u, node_t v, weight_t w) { addEdge(u, v, w); });
+    spinner.markAsCompleted();
+}
+UnweightedDiGraph::UnweightedDiGraph(std::string&& name, EdgeStream& in)
+    : name(name)
+{
+    SetSpinner spinner(std::format("Reading UnweightedDiGraph {}", this->name), in.size());
+    ReadEdgeList<false>(in, spinner, [this](node_t u, node_t v) { addEdge(u, v); });
+    spinner.markAsCompleted();
+}
+WeightedDiGraph::WeightedDiGraph(std::string&& name, EdgeStream& in)
+    : name(name)
+{
+    SetSpinner spinner(std::format("Reading WeightedDiGraph {}", this->name), in.size());
+    ReadEdgeList<true>(in, spinner, [this](node_t u, node_t v, weight_t w) { addEdge(u, v, w); });
+    spinner.markAsCompleted();
+}
+
+// Edges are read first and weighted afterwards, so that the weights are filled in bulk.
+template <typename Graph>
+void AddFilledEdges(Graph& g, const EdgeBuffer<false>& edges, const WeightFiller& filler)
+{
+    std::vector<weight_t> weights(edges.size());
+    FillWeights(filler, weights);
+    for (std::size_t i = 0; i < edges.size(); i++)
+        g.addEdge(edges[i].first, edges[i].second, weights[i]);
+}
+WeightedUndiGraph::WeightedUndiGraph(std::string&& name, std::istream& in, const WeightFiller& filler)
+    : name(name)
+{
+    AddFilledEdges(*this, ReadEdgeBuffer<false, node_t>(in, std::format("Reading WeightedUndiGraph {}", this->name)), filler);
+}
+WeightedUndiGraph::WeightedUndiGraph(std::string&& name, const std::filesystem::path& source, const WeightFiller& filler)
+    : name(name)
+{
+    AddFilledEdges(*this, ReadEdgeBuffer<false, node_t>(source, std::format("Reading WeightedUndiGraph {}", this->name)), filler);
+}
+WeightedUndiGraph::WeightedUndiGraph(std::string&& name, EdgeStream& in, const WeightFiller& filler)
+    : name(name)
+{
+    AddFilledEdges(*this, ReadEdgeBuffer<false, node_t>(in, std::format("Reading WeightedUndiGraph {}", this->name)), filler);
+}
+WeightedDiGraph::WeightedDiGraph(std::string&& name, std::istream& in, const WeightFiller& filler)
+    : name(name)
+{
+    AddFilledEdges(*this, ReadEdgeBuffer<false, node_t>(in, std::format("Reading WeightedDiGraph {}", this->name)), filler);
+}
+WeightedDiGraph::WeightedDiGraph(std::string&& name, const std::filesystem::path& source, const WeightFiller& filler)
+    : name(name)
+{
+    AddFilledEdges(*this, ReadEdgeBuffer<false, node_t>(source, std::format("Reading WeightedDiGraph {}", this->name)), filler);
+}
+WeightedDiGraph::WeightedDiGraph(std::string&& name, EdgeStream& in, const WeightFiller& filler)
+    : name(name)
+{
+    AddFilledEdges(*this, ReadEdgeBuffer<false, node_t>(in, std::format("Reading WeightedDiGraph {}", this->name)), filler);
 }
 }
@@ -1,23 +1,121 @@
 #include "graphkit.h"
 #include "graphkitutils.h"
+#include <algorithm>
 #include <archive.h>
 #include <archive_entry.h>
+#include <atomic>
+#include <condition_variable>
 #include <cpr/callback.h>
 #include <cpr/session.h>
+#include <cstdlib>
+#include <deque>
 #include <exception>
+#include <fcntl.h>
 #include <filesystem>
 #include <format>
 #include <fstream>
 #include <functional>
 #include <ios>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <sys/file.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 namespace gkit {
 namespace fs = std::filesystem;
 
-void DownloadFile(const std::string& url, std::ofstream& fout)
+constexpr std::uint64_t downloadSegSize = 1 << 23;
+constexpr unsigned downloadConnNum = 8;
+constexpr int downloadRetryNum = 3;
+
+// Fetches [0, length) of url into partPath as fixed-size segments over several connections.
+// Finished segments are appended to donePath once their bytes are on disk, so a rerun after
+// an interruption only fetches the missing ones.
+void DownloadSegments(const std::string& url, const fs::path& partPath, const fs::path& donePath, std::uint64_t length)
 {
+    const std::uint64_t segNum = (length + downloadSegSize - 1) / downloadSegSize;
+    std::vector<bool> done(segNum);
+    if (fs::exists(partPath) && fs::file_size(partPath) == length) {
+        std::ifstream doneIn(donePath);
+        for (std::uint64_t seg; doneIn >> seg;)
+            if (seg < segNum)
+                done[seg] = true;
+    } else {
+        std::ofstream(partPath, std::ios::binary | std::ios::trunc).close();
+        fs::resize_file(partPath, length);
+        fs::remove(donePath);
+    }
+    auto segBegin = [](std::uint64_t seg) { return seg * downloadSegSize; };
+    auto segEnd = [length](std::uint64_t seg) { return std::min((seg + 1) * downloadSegSize, length); };
+    std::vector<std::uint64_t> todo;
+    std::uint64_t doneBytes = 0;
+    for (std::uint64_t seg = 0; seg < segNum; seg++) {
+        if (done[seg])
+            doneBytes += segEnd(seg) - segBegin(seg);
+        else
+            todo.push_back(seg);
+    }
+    const int fd = open(partPath.c_str(), O_WRONLY);
+    if (fd < 0) {
+        std::string errStr = std::format("Failed to open file: {}\n", partPath.string());
+        std::cerr << errStr;
+        std::terminate();
+    }
+    std::ofstream doneOut(donePath, std::ios::app);
+    std::mutex mtx;
+    std::atomic<std::uint64_t> nextTodo(0);
+    std::atomic<bool> failed(false);
+    SetSpinner spinner(std::format("Downloading archive {}...", fs::path(url).filename().string()), length);
+    spinner.setProgress(doneBytes);
+    ParallelRun(std::min<std::uint64_t>(downloadConnNum, todo.size()), [&](unsigned) {
+        cpr::Session session;
+        session.SetUrl(url);
+        for (std::uint64_t i; !failed && (i = nextTodo++) < todo.size();) {
+            const std::uint64_t seg = todo[i], lo = segBegin(seg), hi = segEnd(seg);
+            cpr::Response r;
+            for (int retry = 0; retry < downloadRetryNum; retry++) {
+                session.SetHeader(cpr::Header { { "Range", std::format("bytes={}-{}", lo, hi - 1) } });
+                r = session.Get();
+                if (!r.error && r.status_code == 206 && r.text.size() == hi - lo)
+                    break;
+            }
+            if (r.error || r.status_code != 206 || r.text.size() != hi - lo) {
+                failed = true;
+                break;
+            }
+            std::uint64_t written = 0;
+            for (ssize_t size; written < r.text.size(); written += size)
+                if ((size = pwrite(fd, r.text.data() + written, r.text.size() - written, lo + written)) <= 0)
+                    break;
+            if (written != r.text.size() || fdatasync(fd) != 0) {
+                failed = true;
+                break;
+            }
+            std::lock_guard lock(mtx);
+            doneOut << seg << std::endl;
+            doneBytes += hi - lo;
+            spinner.setProgress(doneBytes);
+        }
+    });
+    close(fd);
+    if (failed) {
+        std::string errStr = std::format("Failed to download {}, rerun to resume\n", url);
+        std::cerr << errStr;
+        std::terminate();
+    }
+    spinner.markAsCompleted();
+}
+
+// Fallback for servers that do not report a length or do not accept byte ranges.
+void DownloadStream(const std::string& url, const fs::path& partPath)
+{
+    std::ofstream fout(partPath, std::ios::binary | std::ios::trunc);
     cpr::Session session;
     session.SetUrl(url);
     SetSpinner spinner(std::format("Downloading archive {}...", fs::path(url).filename().string()), session.GetDownloadFileLength());
@@ -25,10 +123,65 @@ void DownloadFile(const std::string& url, std::ofstream& fout)
         spinner.setProgress(downloadNow);
         return true;
     }));
-    session.Download(fout);
+    cpr::Response r = session.Download(fout);
+    if (r.error || r.status_code != 200) {
+        std::string errStr = std::format("Failed to download {}: {}\n", url, r.error ? r.error.message : std::format("HTTP {}", r.status_code));
+        std::cerr << errStr;
+        std::terminate();
+    }
     spinner.markAsCompleted();
 }
 
+void DownloadFile(const std::string& url, const fs::path& path, const std::function<bool(const fs::path&)>& verify)
+{
+    const fs::path partPath = fs::path(path).concat(".part"), donePath = fs::path(path).concat(".part.done");
+    cpr::Session session;
+    session.SetUrl(url);
+    cpr::Response head = session.Head();
+    std::uint64_t length = 0;
+    bool ranged = false;
+    if (!head.error && head.status_code == 200) {
+        if (auto it = head.header.find("content-length"); it != head.header.end())
+            length = std::stoull(it->second);
+        if (auto it = head.header.find("accept-ranges"); it != head.header.end())
+            ranged = it->second == "bytes";
+    }
+    if (ranged && length > 0)
+        DownloadSegments(url, partPath, donePath, length);
+    else
+        DownloadStream(url, partPath);
+    if ((length > 0 && fs::file_size(partPath) != length) || (verify && !verify(partPath))) {
+        fs::remove(partPath), fs::remove(donePath);
+        std::string errStr = std::format("Downloaded file failed integrity check: {}\n", url);
+        std::cerr << errStr;
+        std::terminate();
+    }
+    fs::rename(partPath, path);
+    fs::remove(donePath);
+}
+
+// Decompresses every member of the archive without writing it anywhere, so that truncated
+// or corrupted downloads are caught by the decompressor checksums before extraction.
+bool VerifyArchive(const fs::path& path, std::function<int(archive*)> formatFunc)
+{
+    archive* a = archive_read_new();
+    archive_read_support_filter_all(a);
+    formatFunc(a);
+    bool valid = archive_read_open_filename(a, path.c_str(), 10240) == ARCHIVE_OK;
+    archive_entry* entry;
+    int status = ARCHIVE_FATAL;
+    while (valid && (status = archive_read_next_header(a, &entry)) == ARCHIVE_OK) {
+        char buf[8192];
+        la_ssize_t size;
+        while ((size = archive_read_data(a, buf, sizeof(buf))) > 0)
+            ;
+        valid = size == 0;
+    }
+    valid = valid && status == ARCHIVE_EOF;
+    archive_read_free(a);
+    return valid;
+}
+
 void ExtractFile(const fs::path& path, std::function<int(archive*)> formatFunc)
 {
     archive* a = archive_read_new();
@@ -61,6 +214,125 @@ void ExtractFile(const fs::path& path, std::function<int(archive*)> formatFunc)
     }
 }
 
+// Decompresses one archive member on a worker thread into a small ring of chunks,
+// so that decompression overlaps with parsing on the consumer thread. The member is the first
+// one accepted by memberFilter; memberDesc describes the filter in the error when none is.
+struct ArchiveStream : EdgeStream {
+    static constexpr std::size_t chunkSize = 1 << 22;
+    static constexpr std::size_t chunkNum = 4;
+    archive* a;
+    std::uint64_t archiveSize;
+    std::atomic<std::uint64_t> readBytes;
+    std::vector<std::string> chunks;
+    std::vector<std::size_t> chunkLens;
+    std::deque<std::size_t> freeChunks, fullChunks;
+    std::optional<std::size_t> curChunk;
+    bool finished, stopped;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::thread worker;
+    ArchiveStream(const fs::path& path, std::function<int(archive*)> formatFunc, std::function<bool(const fs::path&)> memberFilter, std::string memberDesc)
+        : a(archive_read_new())
+        , archiveSize(fs::file_size(path))
+        , readBytes(0)
+        , chunks(chunkNum, std::string(chunkSize, '\0'))
+        , chunkLens(chunkNum)
+        , finished(false)
+        , stopped(false)
+    {
+        archive_read_support_filter_all(a);
+        formatFunc(a);
+        if (archive_read_open_filename(a, path.c_str(), 10240) != ARCHIVE_OK) {
+            std::string errStr = std::format("Failed to open archive: {}\n", archive_error_string(a));
+            std::cerr << errStr;
+            std::terminate();
+        }
+        for (std::size_t i = 0; i < chunkNum; i++)
+            freeChunks.push_back(i);
+        worker = std::thread([this, path, memberFilter, memberDesc]() { decompress(path, memberFilter, memberDesc); });
+    }
+    ~ArchiveStream()
+    {
+        {
+            std::lock_guard lock(mtx);
+            stopped = true;
+        }
+        cv.notify_all();
+        worker.join();
+        archive_read_free(a);
+    }
+    void decompress(const fs::path& path, const std::function<bool(const fs::path&)>& memberFilter, const std::string& memberDesc)
+    {
+        archive_entry* entry;
+        bool found = false;
+        while (!found && archive_read_next_header(a, &entry) == ARCHIVE_OK)
+            found = archive_entry_filetype(entry) != AE_IFDIR && memberFilter(archive_entry_pathname(entry));
+        if (!found) {
+            std::string errStr = std::format("No {} member in archive: {}\n", memberDesc, path.string());
+            std::cerr << errStr;
+            std::terminate();
+        }
+        for (bool eof = false; !eof;) {
+            std::size_t i;
+            {
+                std::unique_lock lock(mtx);
+                cv.wait(lock, [this]() { return !freeChunks.empty() || stopped; });
+                if (stopped)
+                    return;
+                i = freeChunks.front();
+                freeChunks.pop_front();
+            }
+            std::size_t len = 0;
+            while (len < chunkSize) {
+                la_ssize_t size = archive_read_data(a, chunks[i].data() + len, chunkSize - len);
+                if (size < 0) {
+                    std::string errStr = std::format("Failed to decompress archive: {}\n", archive_error_string(a));
+                    std::cerr << errStr;
+                    std::terminate();
+                }
+                if (size == 0) {
+                    eof = true;
+                    break;
+                }
+                len += size;
+            }
+            chunkLens[i] = len;
+            readBytes = archive_filter_bytes(a, -1);
+            {
+                std::lock_guard lock(mtx);
+                fullChunks.push_back(i);
+            }
+            cv.notify_all();
+        }
+        {
+            std::lock_guard lock(mtx);
+            finished = true;
+        }
+        cv.notify_all();
+    }
+    std::string_view next() override
+    {
+        std::unique_lock lock(mtx);
+        if (curChunk) {
+            freeChunks.push_back(*curChunk);
+            curChunk.reset();
+            cv.notify_all();
+        }
+        cv.wait(lock, [this]() { return !fullChunks.empty() || finished; });
+        while (!fullChunks.empty() && chunkLens[fullChunks.front()] == 0) {
+            freeChunks.push_back(fullChunks.front());
+            fullChunks.pop_front();
+        }
+        if (fullChunks.empty())
+            return {};
+        curChunk = fullChunks.front();
+        fullChunks.pop_front();
+        return std::string_view(chunks[*curChunk].data(), chunkLens[*curChunk]);
+    }
+    std::uint64_t size() const override { return archiveSize; }
+    std::uint64_t position() const override { return readBytes; }
+};
+
 fs::path SearchKonectPath(const fs::path& dirPath)
 {
     if (!fs::exists(dirPath))
@@ -73,6 +345,25 @@ fs::path SearchKonectPath(const fs::path& dirPath)
     return {};
 }
 
+fs::path GetKonectArchive(const std::string& internalName)
+{
+    const fs::path bzPath = std::filesystem::temp_directory_path() / std::format("{}.tar.bz2", internalName);
+    if (!fs::exists(bzPath)) {
+        std::string url = std::format("http://konect.cc/files/download.tsv.{}.tar.bz2", internalName);
+        DownloadFile(url, bzPath, [](const fs::path& path) { return VerifyArchive(path, archive_read_support_format_all); });
+    }
+    return bzPath;
+}
+
+fs::path GetSnapArchive(const std::string& url)
+{
+    const fs::path gzPath = std::filesystem::temp_directory_path() / fs::path(url).filename();
+    if (!fs::exists(gzPath)) {
+        DownloadFile(url, gzPath, [](const fs::path& path) { return VerifyArchive(path, archive_read_support_format_raw); });
+    }
+    return gzPath;
+}
+
 fs::path GetKonectPath(const std::string& internalName)
 {
     const fs::path tmpDir = std::filesystem::temp_directory_path();
@@ -82,13 +373,7 @@ fs::path GetKonectPath(const std::string& internalName)
         return filePath;
     else if (fs::exists(dirPath))
         fs::remove_all(dirPath);
-    const fs::path bzPath = tmpDir / std::format("{}.tar.bz2", internalName);
-    if (!fs::exists(bzPath)) {
-        std::string url = std::format("http://konect.cc/files/download.tsv.{}.tar.bz2", internalName);
-        std::ofstream fout(bzPath, std::ios::binary);
-        DownloadFile(url, fout);
-    }
-    ExtractFile(bzPath, archive_read_support_format_all);
+    ExtractFile(GetKonectArchive(internalName), archive_read_support_format_all);
     return SearchKonectPath(dirPath);
 }
 
@@ -99,12 +384,76 @@ fs::path GetSnapPath(const std::string& url)
     const fs::path filePath = tmpDir / urlPath.stem();
     if (fs::exists(filePath))
         return filePath;
-    const fs::path gzPath = tmpDir / urlPath.filename();
-    if (!fs::exists(gzPath)) {
-        std::ofstream fout(gzPath, std::ios::binary);
-        DownloadFile(url, fout);
-    }
-    ExtractFile(gzPath, archive_read_support_format_raw);
+    ExtractFile(GetSnapArchive(url), archive_read_support_format_raw);
     return filePath;
 }
+
+fs::path FindKonectPath(const std::string& internalName)
+{
+    return SearchKonectPath(std::filesystem::temp_directory_path() / internalName);
+}
+
+fs::path FindSnapPath(const std::string& url)
+{
+    const fs::path filePath = std::filesystem::temp_directory_path() / fs::path(url).stem();
+    return fs::exists(filePath) ? filePath : fs::path();
+}
+
+std::unique_ptr<EdgeStream> OpenKonectStream(const std::string& internalName)
+{
+    return std::make_unique<ArchiveStream>(GetKonectArchive(internalName), archive_read_support_format_all, [](const fs::path& member) {
+        return member.filename().string().starts_with("out.");
+    }, "out.*");
+}
+
+std::unique_ptr<EdgeStream> OpenSnapStream(const std::string& url)
+{
+    return std::make_unique<ArchiveStream>(GetSnapArchive(url), archive_read_support_format_raw, [](const fs::path&) { return true; }, "file");
+}
+
+fs::path DefaultCacheDir()
+{
+    if (const char* dir = std::getenv("GKIT_CACHE_DIR"))
+        return dir;
+    if (const char* dir = std::getenv("XDG_CACHE_HOME"))
+        return fs::path(dir) / "graphkit";
+    if (const char* dir = std::getenv("HOME"))
+        return fs::path(dir) / ".cache" / "graphkit";
+    return std::filesystem::temp_directory_path() / "graphkit-cache";
+}
+
+static fs::path cacheDir = DefaultCacheDir();
+fs::path GetCacheDir() { return cacheDir; }
+void SetCacheDir(const fs::path& dir) { cacheDir = dir; }
+
+fs::path GetCachePath(const std::string& source, const std::string& key, const std::string& typeName)
+{
+    std::string fileName = std::format("{}.{}.v{}n{}o{}.gks", key, typeName, snapshotVersion, sizeof(node_t) * 8, sizeof(offset_t) * 8);
+    std::ranges::replace(fileName, '/', '_');
+    return cacheDir / source / fileName;
+}
+
+CacheLock::CacheLock(const fs::path& cachePath)
+{
+    fs::create_directories(cachePath.parent_path());
+    const fs::path lockPath = fs::path(cachePath).concat(".lock");
+    fd = open(lockPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0 || flock(fd, LOCK_EX) != 0) {
+        std::string errStr = std::format("Failed to lock cache entry: {}\n", lockPath.string());
+        std::cerr << errStr;
+        std::terminate();
+    }
+}
+CacheLock::~CacheLock()
+{
+    flock(fd, LOCK_UN);
+    close(fd);
+}
+
+void StoreCache(const fs::path& cachePath, const std::function<void(const fs::path&)>& save)
+{
+    const fs::path tmpPath = fs::path(cachePath).concat(std::format(".{}.tmp", getpid()));
+    save(tmpPath);
+    fs::rename(tmpPath, cachePath);
+}
 }
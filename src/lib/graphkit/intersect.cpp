@@ -0,0 +1,199 @@
+#include "graphkit.h"
+#include "graphkitcompact.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <span>
+#include <utility>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define GKIT_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using gkit::node_t, gkit::IntersectionKernel;
+using std::uint64_t;
+
+namespace {
+// From this size ratio on, the shorter list is searched in the longer one instead of merged.
+constexpr uint64_t gallopRatio = 32;
+
+template <bool Emit>
+uint64_t ScalarIntersect(const node_t* a, uint64_t aSize, const node_t* b, uint64_t bSize, uint64_t i, uint64_t j, node_t* out)
+{
+    uint64_t count = 0;
+    while (i < aSize && j < bSize) {
+        const node_t x = a[i], y = b[j];
+        if (x == y) {
+            if constexpr (Emit)
+                out[count] = x;
+            count++;
+        }
+        i += x <= y, j += y <= x;
+    }
+    return count;
+}
+
+// Each element of the shorter list a is looked up in the rest of b by doubling steps and binary search.
+template <bool Emit>
+uint64_t GallopIntersect(const node_t* a, uint64_t aSize, const node_t* b, uint64_t bSize, node_t* out)
+{
+    uint64_t count = 0, j = 0;
+    for (uint64_t i = 0; i < aSize && j < bSize; i++) {
+        uint64_t step = 1;
+        while (j + step < bSize && b[j + step] < a[i])
+            step <<= 1;
+        j = std::lower_bound(b + j, b + std::min(j + step + 1, bSize), a[i]) - b;
+        if (j < bSize && b[j] == a[i]) {
+            if constexpr (Emit)
+                out[count] = a[i];
+            count++;
+        }
+    }
+    return count;
+}
+
+// Appends the elements of a block whose bit is set in mask.
+template <bool Emit>
+uint64_t TakeMask(const node_t* block, uint64_t mask, node_t* out)
+{
+    if constexpr (Emit) {
+        uint64_t count = 0;
+        for (; mask != 0; mask &= mask - 1)
+            out[count++] = block[std::countr_zero(mask)];
+        return count;
+    }
+    return std::popcount(mask);
+}
+
+#ifdef GKIT_X86_SIMD
+// Block merge: a block of a is compared with every rotation of a block of b, and the block with
+// the smaller last element moves on. Blocks that are never current together cannot share elements.
+template <bool Emit>
+__attribute__((target("avx2"))) uint64_t AVX2Intersect(const node_t* a, uint64_t aSize, const node_t* b, uint64_t bSize, node_t* out)
+{
+    constexpr uint64_t lanes = 32 / sizeof(node_t);
+    uint64_t i = 0, j = 0, count = 0;
+    while (i + lanes <= aSize && j + lanes <= bSize) {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+        uint64_t mask;
+        if constexpr (sizeof(node_t) == 8) {
+            __m256i eq = _mm256_cmpeq_epi64(va, vb);
+            for (unsigned r = 1; r < lanes; r++) {
+                vb = _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1));
+                eq = _mm256_or_si256(eq, _mm256_cmpeq_epi64(va, vb));
+            }
+            mask = _mm256_movemask_pd(_mm256_castsi256_pd(eq));
+        } else {
+            const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+            __m256i eq = _mm256_cmpeq_epi32(va, vb);
+            for (unsigned r = 1; r < lanes; r++) {
+                vb = _mm256_permutevar8x32_epi32(vb, rotate);
+                eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(va, vb));
+            }
+            mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        }
+        count += TakeMask<Emit>(a + i, mask, out + count);
+        const node_t aLast = a[i + lanes - 1], bLast = b[j + lanes - 1];
+        i += aLast <= bLast ? lanes : 0, j += bLast <= aLast ? lanes : 0;
+    }
+    return count + ScalarIntersect<Emit>(a, aSize, b, bSize, i, j, out + count);
+}
+
+template <bool Emit>
+__attribute__((target("avx512f"))) uint64_t AVX512Intersect(const node_t* a, uint64_t aSize, const node_t* b, uint64_t bSize, node_t* out)
+{
+    constexpr uint64_t lanes = 64 / sizeof(node_t);
+    uint64_t i = 0, j = 0, count = 0;
+    while (i + lanes <= aSize && j + lanes <= bSize) {
+        const __m512i va = _mm512_loadu_si512(a + i);
+        __m512i vb = _mm512_loadu_si512(b + j);
+        uint64_t mask;
+        if constexpr (sizeof(node_t) == 8) {
+            __mmask8 eq = _mm512_cmpeq_epi64_mask(va, vb);
+            for (unsigned r = 1; r < lanes; r++) {
+                vb = _mm512_mask_alignr_epi64(vb, 0xff, vb, vb, 1);
+                eq |= _mm512_cmpeq_epi64_mask(va, vb);
+            }
+            mask = eq;
+        } else {
+            __mmask16 eq = _mm512_cmpeq_epi32_mask(va, vb);
+            for (unsigned r = 1; r < lanes; r++) {
+                vb = _mm512_mask_alignr_epi32(vb, 0xffff, vb, vb, 1);
+                eq |= _mm512_cmpeq_epi32_mask(va, vb);
+            }
+            mask = eq;
+        }
+        count += TakeMask<Emit>(a + i, mask, out + count);
+        const node_t aLast = a[i + lanes - 1], bLast = b[j + lanes - 1];
+        i += aLast <= bLast ? lanes : 0, j += bLast <= aLast ? lanes : 0;
+    }
+    return count + ScalarIntersect<Emit>(a, aSize, b, bSize, i, j, out + count);
+}
+#endif
+
+bool KernelSupported(IntersectionKernel kernel)
+{
+#ifdef GKIT_X86_SIMD
+    if (kernel == IntersectionKernel::AVX2)
+        return __builtin_cpu_supports("avx2");
+    if (kernel == IntersectionKernel::AVX512)
+        return __builtin_cpu_supports("avx512f");
+#endif
+    return kernel == IntersectionKernel::Scalar;
+}
+
+template <IntersectionKernel Kernel, bool Emit>
+uint64_t Intersect(const node_t* a, uint64_t aSize, const node_t* b, uint64_t bSize, node_t* out)
+{
+    if (aSize > bSize)
+        std::swap(a, b), std::swap(aSize, bSize);
+    if (aSize * gallopRatio < bSize)
+        return GallopIntersect<Emit>(a, aSize, b, bSize, out);
+#ifdef GKIT_X86_SIMD
+    if constexpr (Kernel == IntersectionKernel::AVX512)
+        return AVX512Intersect<Emit>(a, aSize, b, bSize, out);
+    if constexpr (Kernel == IntersectionKernel::AVX2)
+        return AVX2Intersect<Emit>(a, aSize, b, bSize, out);
+#endif
+    return ScalarIntersect<Emit>(a, aSize, b, bSize, 0, 0, out);
+}
+
+template <bool Emit>
+gkit::IntersectFunction KernelFunction(IntersectionKernel kernel)
+{
+    switch (kernel) {
+    case IntersectionKernel::AVX512:
+        return Intersect<IntersectionKernel::AVX512, Emit>;
+    case IntersectionKernel::AVX2:
+        return Intersect<IntersectionKernel::AVX2, Emit>;
+    default:
+        return Intersect<IntersectionKernel::Scalar, Emit>;
+    }
+}
+}
+
+namespace gkit {
+IntersectFunction GetIntersectFunction(IntersectionKernel kernel, bool emit)
+{
+    if (kernel == IntersectionKernel::Auto) {
+        static const IntersectionKernel best = KernelSupported(IntersectionKernel::AVX512) ? IntersectionKernel::AVX512
+            : KernelSupported(IntersectionKernel::AVX2)                                    ? IntersectionKernel::AVX2
+                                                                                           : IntersectionKernel::Scalar;
+        kernel = best;
+    }
+    if (!KernelSupported(kernel)) {
+        std::cerr << "Intersection kernel not supported by this CPU\n";
+        std::terminate();
+    }
+    return emit ? KernelFunction<true>(kernel) : KernelFunction<false>(kernel);
+}
+
+std::uint64_t IntersectionSize(std::span<const node_t> a, std::span<const node_t> b, IntersectionKernel kernel)
+{
+    return GetIntersectFunction(kernel, false)(a.data(), a.size(), b.data(), b.size(), nullptr);
+}
+}
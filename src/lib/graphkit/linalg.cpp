@@ -1,9 +1,113 @@
 #include "graphkit.h"
+#include "graphkitcompact.h"
+#include "graphkitparser.h"
+#include "graphkitutils.h"
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
 #include <vector>
 
+namespace {
+constexpr std::uint64_t spmvBlockSize = 1 << 10;
+
+// Writes an n x n column-major matrix straight into Eigen's compressed arrays: column u gets
+// degree(u) entries from fill(u, rows, values), in any order. No triplets are built.
+template <typename Degree, typename Fill>
+Eigen::SparseMatrix<double> CompressedMatrix(gkit::node_t n, Degree&& degree, Fill&& fill)
+{
+    gkit::CheckIndexRange<int>(n, "Matrix dimension");
+    Eigen::SparseMatrix<double> mat(n, n);
+    int* outer = mat.outerIndexPtr();
+    std::uint64_t nnz = 0;
+    for (gkit::node_t u = 0; u < n; u++) {
+        outer[u] = nnz;
+        nnz += degree(u);
+        gkit::CheckIndexRange<int>(nnz, "Matrix nonzero count");
+    }
+    outer[n] = nnz;
+    mat.resizeNonZeros(nnz);
+    ParallelFor(gkit::GetThreadNum(), 0, n, spmvBlockSize, [&](std::uint64_t u) {
+        int* rows = mat.innerIndexPtr() + outer[u];
+        double* values = mat.valuePtr() + outer[u];
+        const int size = outer[u + 1] - outer[u];
+        fill(u, rows, values);
+        if (std::is_sorted(rows, rows + size))
+            return;
+        std::vector<std::pair<int, double>> entries(size);
+        for (int i = 0; i < size; i++)
+            entries[i] = { rows[i], values[i] };
+        std::ranges::sort(entries);
+        for (int i = 0; i < size; i++)
+            rows[i] = entries[i].first, values[i] = entries[i].second;
+    });
+    return mat;
+}
+
+// Matrix whose column u has 1 at the rows in posAdjs[u] and -1 at those in negAdjs[u], if given.
+Eigen::SparseMatrix<double> AdjColumns(const gkit::CSR& posAdjs, const gkit::CSR* negAdjs)
+{
+    return CompressedMatrix(
+        posAdjs.size(), [&](gkit::node_t u) { return posAdjs.degree(u) + (negAdjs != nullptr ? negAdjs->degree(u) : 0); },
+        [&](gkit::node_t u, int* rows, double* values) {
+            for (const gkit::node_t& v : posAdjs[u])
+                *rows++ = v, *values++ = 1;
+            if (negAdjs != nullptr)
+                for (const gkit::node_t& v : (*negAdjs)[u])
+                    *rows++ = v, *values++ = -1;
+        });
+}
+}
+
 namespace gkit {
+LaplacianOperator::LaplacianOperator(const CSR& adjs, LaplacianKind kind)
+    : posAdjs(adjs)
+    , negAdjs(nullptr)
+    , kind(kind)
+    , degr(adjs.size())
+{
+    for (node_t u = 0; u < adjs.size(); u++)
+        degr[u] = adjs.degree(u);
+    if (kind == LaplacianKind::Normalized)
+        invSqrtDegr = degr.unaryExpr([](double d) { return d > 0 ? 1 / std::sqrt(d) : 0.0; });
+}
+LaplacianOperator::LaplacianOperator(const CSR& posAdjs, const CSR& negAdjs, LaplacianKind kind)
+    : posAdjs(posAdjs)
+    , negAdjs(&negAdjs)
+    , kind(kind)
+    , degr(posAdjs.size())
+{
+    for (node_t u = 0; u < posAdjs.size(); u++)
+        degr[u] = posAdjs.degree(u) + negAdjs.degree(u);
+    if (kind == LaplacianKind::Normalized)
+        invSqrtDegr = degr.unaryExpr([](double d) { return d > 0 ? 1 / std::sqrt(d) : 0.0; });
+}
+Eigen::VectorXd LaplacianOperator::diagonal() const
+{
+    if (kind == LaplacianKind::Combinatorial)
+        return degr;
+    return degr.unaryExpr([](double d) { return d > 0 ? 1.0 : 0.0; });
+}
+void LaplacianOperator::apply(const Eigen::VectorXd& x, Eigen::VectorXd& y) const
+{
+    const bool normalized = kind == LaplacianKind::Normalized;
+    // Scaling x once keeps the inner loops the same for both kinds.
+    const Eigen::VectorXd scaledX = normalized ? Eigen::VectorXd(invSqrtDegr.cwiseProduct(x)) : Eigen::VectorXd();
+    const double* in = normalized ? scaledX.data() : x.data();
+    y.resize(rows());
+    ParallelFor(GetThreadNum(), 0, rows(), spmvBlockSize, [&](std::uint64_t u) {
+        double sum = 0;
+        for (const node_t& v : posAdjs[u])
+            sum += in[v];
+        if (negAdjs != nullptr)
+            for (const node_t& v : (*negAdjs)[u])
+                sum -= in[v];
+        y[u] = normalized ? (degr[u] > 0 ? x[u] : 0.0) - invSqrtDegr[u] * sum : degr[u] * x[u] - sum;
+    });
+}
+
 Eigen::VectorXd SimpleUndiGraph::degrVec() const
 {
     Eigen::VectorXd degr(n);
@@ -11,25 +115,11 @@ Eigen::VectorXd SimpleUndiGraph::degrVec() const
         degr[i] = adjs[i].size();
     return degr;
 }
-Eigen::SparseMatrix<double> SimpleUndiGraph::degrMat() const
-{
-    std::vector<Eigen::Triplet<double>> tripletVec(n);
-    for (int i = 0; i < n; i++)
-        tripletVec[i] = { i, i, static_cast<double>(adjs[i].size()) };
-    Eigen::SparseMatrix<double> degr(n, n);
-    degr.setFromTriplets(tripletVec.cbegin(), tripletVec.cend());
-    return degr;
-}
+Eigen::DiagonalMatrix<double, Eigen::Dynamic> SimpleUndiGraph::degrMat() const { return Eigen::DiagonalMatrix<double, Eigen::Dynamic>(degrVec()); }
+// A is symmetric, so the adjacency lists are its columns too.
 Eigen::SparseMatrix<double> SimpleUndiGraph::adjMat() const
 {
-    std::vector<Eigen::Triplet<double>> tripletVec;
-    tripletVec.reserve(m << 1);
-    for (node_t u = 0; u < n; u++)
-        for (const node_t& v : adjs[u])
-            tripletVec.emplace_back(u, v, 1);
-    Eigen::SparseMatrix<double> adjSpMat(n, n);
-    adjSpMat.setFromTriplets(tripletVec.cbegin(), tripletVec.cend());
-    return adjSpMat;
+    return AdjColumns(adjs, nullptr);
 }
 
 Eigen::VectorXd SimpleDiGraph::degrVec() const
@@ -39,25 +129,11 @@ Eigen::VectorXd SimpleDiGraph::degrVec() const
         degr[i] = adjs[i].size();
     return degr;
 }
-Eigen::SparseMatrix<double> SimpleDiGraph::degrMat() const
-{
-    std::vector<Eigen::Triplet<double>> tripletVec(n);
-    for (int i = 0; i < n; i++)
-        tripletVec[i] = { i, i, static_cast<double>(adjs[i].size()) };
-    Eigen::SparseMatrix<double> degr(n, n);
-    degr.setFromTriplets(tripletVec.cbegin(), tripletVec.cend());
-    return degr;
-}
+Eigen::DiagonalMatrix<double, Eigen::Dynamic> SimpleDiGraph::degrMat() const { return Eigen::DiagonalMatrix<double, Eigen::Dynamic>(degrVec()); }
+// Column v of A lists the in-neighbours of v, which the cached reverse lists already hold.
 Eigen::SparseMatrix<double> SimpleDiGraph::adjMat() const
 {
-    std::vector<Eigen::Triplet<double>> tripletVec;
-    tripletVec.reserve(m);
-    for (node_t u = 0; u < n; u++)
-        for (const node_t& v : adjs[u])
-            tripletVec.emplace_back(u, v, 1);
-    Eigen::SparseMatrix<double> adjSpMat(n, n);
-    adjSpMat.setFromTriplets(tripletVec.cbegin(), tripletVec.cend());
-    return adjSpMat;
+    return AdjColumns(InvAdjs(), nullptr);
 }
 
 Eigen::VectorXd SignedUndiGraph::degrVec() const
@@ -67,29 +143,8 @@ Eigen::VectorXd SignedUndiGraph::degrVec() const
         degr[i] = posAdjs[i].size() + negAdjs[i].size();
     return degr;
 }
-Eigen::SparseMatrix<double> SignedUndiGraph::degrMat() const
-{
-    std::vector<Eigen::Triplet<double>> tripletVec(n);
-    for (int i = 0; i < n; i++)
-        tripletVec[i] = { i, i, static_cast<double>(posAdjs[i].size() + negAdjs[i].size()) };
-    Eigen::SparseMatrix<double> degr(n, n);
-    degr.setFromTriplets(tripletVec.cbegin(), tripletVec.cend());
-    return degr;
-}
-Eigen::SparseMatrix<double> SignedUndiGraph::adjMat() const
-{
-    std::vector<Eigen::Triplet<double>> tripletVec;
-    tripletVec.reserve(m << 1);
-    for (node_t u = 0; u < n; u++) {
-        for (const node_t& v : posAdjs[u])
-            tripletVec.emplace_back(u, v, 1);
-        for (const node_t& v : negAdjs[u])
-            tripletVec.emplace_back(u, v, -1);
-    }
-    Eigen::SparseMatrix<double> adjSpMat(n, n);
-    adjSpMat.setFromTriplets(tripletVec.cbegin(), tripletVec.cend());
-    return adjSpMat;
-}
+Eigen::DiagonalMatrix<double, Eigen::Dynamic> SignedUndiGraph::degrMat() const { return Eigen::DiagonalMatrix<double, Eigen::Dynamic>(degrVec()); }
+Eigen::SparseMatrix<double> SignedUndiGraph::adjMat() const { return AdjColumns(posAdjs, &negAdjs); }
 
 Eigen::VectorXd SignedDiGraph::degrVec() const
 {
@@ -98,27 +153,34 @@ Eigen::VectorXd SignedDiGraph::degrVec() const
         degr[i] = posAdjs[i].size() + negAdjs[i].size();
     return degr;
 }
-Eigen::SparseMatrix<double> SignedDiGraph::degrMat() const
+Eigen::DiagonalMatrix<double, Eigen::Dynamic> SignedDiGraph::degrMat() const { return Eigen::DiagonalMatrix<double, Eigen::Dynamic>(degrVec()); }
+Eigen::SparseMatrix<double> SignedDiGraph::adjMat() const
 {
-    std::vector<Eigen::Triplet<double>> tripletVec(n);
-    for (int i = 0; i < n; i++)
-        tripletVec[i] = { i, i, static_cast<double>(posAdjs[i].size() + negAdjs[i].size()) };
-    Eigen::SparseMatrix<double> degr(n, n);
-    degr.setFromTriplets(tripletVec.cbegin(), tripletVec.cend());
+    const CSR invPosAdjs = Transpose(posAdjs), invNegAdjs = Transpose(negAdjs);
+    return AdjColumns(invPosAdjs, &invNegAdjs);
+}
+
+Eigen::VectorXd ExpansionView::degrVec() const
+{
+    Eigen::VectorXd degr(nodeNum());
+    for (node_t u = 0; u < nodeNum(); u++)
+        degr[u] = degree(u);
     return degr;
 }
-Eigen::SparseMatrix<double> SignedDiGraph::adjMat() const
+Eigen::DiagonalMatrix<double, Eigen::Dynamic> ExpansionView::degrMat() const { return Eigen::DiagonalMatrix<double, Eigen::Dynamic>(degrVec()); }
+// The columns are the lists of the transposed view, which is the view itself when symmetric.
+Eigen::SparseMatrix<double> ExpansionView::adjMat() const
 {
-    std::vector<Eigen::Triplet<double>> tripletVec;
-    tripletVec.reserve(m);
-    for (node_t u = 0; u < n; u++) {
-        for (const node_t& v : posAdjs[u])
-            tripletVec.emplace_back(u, v, 1);
-        for (const node_t& v : negAdjs[u])
-            tripletVec.emplace_back(u, v, -1);
-    }
-    Eigen::SparseMatrix<double> adjSpMat(n, n);
-    adjSpMat.setFromTriplets(tripletVec.cbegin(), tripletVec.cend());
-    return adjSpMat;
+    auto columns = [](const ExpansionView& view) {
+        return CompressedMatrix(
+            view.nodeNum(), [&view](node_t u) { return view.degree(u); },
+            [&view](node_t u, int* rows, double* values) {
+                view.forEachNeighbor(u, [&](node_t v) { *rows++ = v, *values++ = 1; });
+            });
+    };
+    if (symmetric)
+        return columns(*this);
+    const CSR invPosAdjs = Transpose(posAdjs), invNegAdjs = Transpose(negAdjs);
+    return columns(ExpansionView(n, invPosAdjs, invNegAdjs, false));
+}
 }
-}
\ No newline at end of file
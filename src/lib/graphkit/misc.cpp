@@ -1,18 +1,36 @@
 #include "graphkit.h"
+#include "graphkitcompact.h"
 #include "graphkitutils.h"
+#include <algorithm>
+#include <thread>
 
 namespace gkit {
-std::vector<std::vector<node_t>> SimpleDiGraph::InvAdjs() const
+static unsigned threadNum = std::max(1u, std::thread::hardware_concurrency());
+void SetThreadNum(unsigned newThreadNum) { threadNum = std::max(1u, newThreadNum); }
+unsigned GetThreadNum() { return threadNum; }
+static SCCAlgorithm sccAlgorithm = SCCAlgorithm::Auto;
+void SetSCCAlgorithm(SCCAlgorithm algorithm) { sccAlgorithm = algorithm; }
+SCCAlgorithm GetSCCAlgorithm() { return sccAlgorithm; }
+static IntersectionKernel intersectionKernel = IntersectionKernel::Auto;
+void SetIntersectionKernel(IntersectionKernel kernel) { intersectionKernel = kernel; }
+IntersectionKernel GetIntersectionKernel() { return intersectionKernel; }
+
+CSR::CSR(const std::vector<std::vector<node_t>>& adjs)
+    : offsets(adjs.size() + 1, 0)
+{
+    std::uint64_t total = 0;
+    for (const std::vector<node_t>& adj : adjs)
+        total += adj.size();
+    CheckIndexRange<offset_t>(total, "Adjacency size");
+    for (node_t u = 0; u < adjs.size(); u++)
+        offsets[u + 1] = offsets[u] + adjs[u].size();
+    targets.reserve(offsets.back());
+    for (const std::vector<node_t>& adj : adjs)
+        targets.insert(targets.end(), adj.begin(), adj.end());
+}
+
+const CSR& SimpleDiGraph::InvAdjs() const
 {
-    std::vector<std::vector<node_t>> invAdjs(n);
-    TickSpinner spinner("SimpleDiGraph::InvAdjs: Computing inverse adjacency list...", m);
-    for (node_t u = 0; u < n; u++) {
-        for (const node_t& v : adjs[u]) {
-            invAdjs[v].push_back(u);
-            spinner.tick();
-        }
-    }
-    spinner.markAsCompleted();
-    return invAdjs;
+    return invAdjsCache.get([this]() { return Transpose(adjs); });
 }
 }
@@ -2,6 +2,7 @@
 #include "graphkitutils.h"
 #include <algorithm>
 #include <format>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -40,9 +41,9 @@ std::ostream& operator<<(std::ostream& os, const SimpleUndiGraph& g)
     os << desc;
     TickSpinner spinner(std::format("Writing SimpleUndiGraph {}...", g.name), g.m);
     for (node_t u = 0; u < g.n; u++) {
-        const std::vector<node_t>& adj = g.adjs[u];
+        std::span<const node_t> adj = g.adjs[u];
         auto it = std::ranges::upper_bound(adj, u);
-        std::for_each(it, adj.cend(), [&](const node_t& v) {
+        std::for_each(it, adj.end(), [&](const node_t& v) {
             std::string line = std::format("{}\t{}\n", u, v);
             os << line;
             spinner.tick();
@@ -102,14 +103,14 @@ std::ostream& operator<<(std::ostream& os, const SignedUndiGraph& g)
     os << desc;
     TickSpinner spinner(std::format("Writing SignedUndiGraph {}...", g.name), g.edgeNum());
     for (node_t u = 0; u < g.n; u++) {
-        const std::vector<node_t>&posAdj = g.posAdjs[u], &negAdj = g.negAdjs[u];
+        std::span<const node_t> posAdj = g.posAdjs[u], negAdj = g.negAdjs[u];
         auto posIt = std::ranges::upper_bound(posAdj, u), negIt = std::ranges::upper_bound(negAdj, u);
-        std::for_each(posIt, posAdj.cend(), [&](const node_t& v) {
+        std::for_each(posIt, posAdj.end(), [&](const node_t& v) {
             std::string line = std::format("{}\t{}\t+1\n", u, v);
             os << line;
             spinner.tick();
         });
-        std::for_each(negIt, negAdj.cend(), [&](const node_t& v) {
+        std::for_each(negIt, negAdj.end(), [&](const node_t& v) {
             std::string line = std::format("{}\t{}\t-1\n", u, v);
             os << line;
             spinner.tick();
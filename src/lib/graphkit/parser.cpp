@@ -0,0 +1,87 @@
+#include "graphkitparser.h"
+#include "graphkitutils.h"
+#include <algorithm>
+#include <exception>
+#include <fcntl.h>
+#include <format>
+#include <ios>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gkit {
+std::streamsize GetStreamSize(std::istream& in)
+{
+    std::streampos begin_pos = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::streampos end_pos = in.tellg();
+    std::streamsize file_size = end_pos - begin_pos;
+    in.seekg(0, std::ios::beg);
+    return file_size;
+}
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+    : data(nullptr)
+    , size(0)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        std::string errStr = std::format("Failed to open file: {}\n", path.string());
+        std::cerr << errStr;
+        std::terminate();
+    }
+    size = st.st_size;
+    if (size > 0) {
+        void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            std::string errStr = std::format("Failed to map file: {}\n", path.string());
+            std::cerr << errStr;
+            std::terminate();
+        }
+        madvise(addr, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(addr);
+    }
+    close(fd);
+}
+MappedFile::~MappedFile()
+{
+    if (data != nullptr)
+        munmap(const_cast<char*>(data), size);
+}
+
+std::vector<std::string_view> SplitLines(std::string_view buf, std::size_t parts)
+{
+    std::vector<std::string_view> pieces;
+    const std::size_t pieceSize = buf.size() / std::max<std::size_t>(parts, 1) + 1;
+    while (!buf.empty()) {
+        std::size_t eol = pieceSize < buf.size() ? buf.find('\n', pieceSize) : std::string_view::npos;
+        std::size_t len = eol == std::string_view::npos ? buf.size() : eol + 1;
+        pieces.push_back(buf.substr(0, len));
+        buf.remove_prefix(len);
+    }
+    return pieces;
+}
+
+template <bool Weighted, typename ID>
+std::vector<EdgeBuffer<Weighted, ID>> ParseEdgeListParallel(std::string_view buf, unsigned threadNum)
+{
+    const std::vector<std::string_view> pieces = SplitLines(buf, threadNum);
+    std::vector<EdgeBuffer<Weighted, ID>> buffers(pieces.size());
+    ParallelFor(threadNum, 0, pieces.size(), 1, [&](std::uint64_t i) {
+        EdgeBuffer<Weighted, ID>& edges = buffers[i];
+        edges.reserve(pieces[i].size() / 16);
+        ParseEdgeList<Weighted, ID>(pieces[i], [&edges](auto... fields) { edges.emplace_back(fields...); });
+    });
+    return buffers;
+}
+template std::vector<EdgeBuffer<false>> ParseEdgeListParallel<false, node_t>(std::string_view buf, unsigned threadNum);
+template std::vector<EdgeBuffer<true>> ParseEdgeListParallel<true, node_t>(std::string_view buf, unsigned threadNum);
+// rawID_t is node_t unless node IDs are 32-bit.
+#ifdef GKIT_NODE32
+template std::vector<RawEdgeBuffer<false>> ParseEdgeListParallel<false, rawID_t>(std::string_view buf, unsigned threadNum);
+template std::vector<RawEdgeBuffer<true>> ParseEdgeListParallel<true, rawID_t>(std::string_view buf, unsigned threadNum);
+#endif
+}
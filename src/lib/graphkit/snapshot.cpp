@@ -0,0 +1,212 @@
+#include "graphkit.h"
+#include "graphkitparser.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <format>
+#include <initializer_list>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Snapshot layout (native endianness), every section aligned to 8 bytes:
+//   SnapshotHeader
+//   name bytes, zero-padded
+//   if hasIDs: n rawID_t original node IDs
+//   for each adjacency array (1 for Simple*, 2 for Signed*: positive then negative):
+//     offsets: n + 1 offset_t values, zero-padded; targets of node u are [offsets[u], offsets[u + 1])
+//     targets: offsets[n] node_t values, zero-padded
+namespace gkit {
+enum class SnapshotKind : std::uint32_t {
+    SimpleUndi = 1,
+    SimpleDi = 2,
+    SignedUndi = 3,
+    SignedDi = 4
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t version;
+    SnapshotKind kind;
+    std::uint32_t nodeWidth;
+    std::uint32_t offsetWidth;
+    std::uint32_t adjNum;
+    std::uint32_t hasIDs;
+    std::uint64_t n, m;
+    std::uint64_t nameLen;
+};
+
+constexpr char snapshotMagic[8] = { 'G', 'K', 'I', 'T', 'S', 'N', 'A', 'P' };
+
+std::uint64_t PadTo8(std::uint64_t size) { return (size + 7) & ~7ull; }
+
+void WritePadding(std::ofstream& fout, std::uint64_t size)
+{
+    const char zeros[8] = {};
+    fout.write(zeros, PadTo8(size) - size);
+}
+
+void SaveSnapshot(const std::filesystem::path& path, SnapshotKind kind, node_t n, offset_t m, const std::string& name, const std::vector<rawID_t>& originalIDs, std::initializer_list<const CSR*> adjsList)
+{
+    std::ofstream fout(path, std::ios::binary);
+    if (!fout) {
+        std::string errStr = std::format("Failed to create file: {}\n", path.string());
+        std::cerr << errStr;
+        std::terminate();
+    }
+    SnapshotHeader header { {}, snapshotVersion, kind, sizeof(node_t), sizeof(offset_t), static_cast<std::uint32_t>(adjsList.size()), !originalIDs.empty(), n, m, name.size() };
+    std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fout.write(name.data(), name.size());
+    WritePadding(fout, name.size());
+    fout.write(reinterpret_cast<const char*>(originalIDs.data()), originalIDs.size() * sizeof(rawID_t));
+    for (const CSR* adjs : adjsList) {
+        fout.write(reinterpret_cast<const char*>(adjs->offsets.data()), adjs->offsets.size() * sizeof(offset_t));
+        WritePadding(fout, adjs->offsets.size() * sizeof(offset_t));
+        fout.write(reinterpret_cast<const char*>(adjs->targets.data()), adjs->targets.size() * sizeof(node_t));
+        WritePadding(fout, adjs->targets.size() * sizeof(node_t));
+    }
+    if (!fout) {
+        std::string errStr = std::format("Failed to write snapshot: {}\n", path.string());
+        std::cerr << errStr;
+        std::terminate();
+    }
+}
+
+// Maps a snapshot once and hands out its sections without parsing individual edges.
+struct SnapshotReader {
+    std::filesystem::path path;
+    MappedFile file;
+    SnapshotHeader header;
+    std::uint64_t pos;
+    // Adjacency arrays of the kind, arcs stored per edge, and the arrays and arcs read so far.
+    std::uint32_t adjNum, arcsPerEdge;
+    std::uint32_t adjsRead = 0;
+    std::uint64_t arcNum = 0;
+    SnapshotReader(const std::filesystem::path& path, SnapshotKind kind)
+        : path(path)
+        , file(path)
+        , pos(0)
+        , adjNum(kind == SnapshotKind::SignedUndi || kind == SnapshotKind::SignedDi ? 2 : 1)
+        , arcsPerEdge(kind == SnapshotKind::SimpleUndi || kind == SnapshotKind::SignedUndi ? 2 : 1)
+    {
+        if (file.size < sizeof(header))
+            fail("truncated header");
+        std::memcpy(&header, file.data, sizeof(header));
+        if (std::memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0)
+            fail("bad magic");
+        if (header.version != snapshotVersion)
+            fail(std::format("unsupported version {}", header.version));
+        if (header.kind != kind)
+            fail("graph type mismatch");
+        if (header.nodeWidth != sizeof(node_t))
+            fail(std::format("stored with {}-byte node IDs, expected {}", header.nodeWidth, sizeof(node_t)));
+        if (header.offsetWidth != sizeof(offset_t))
+            fail(std::format("stored with {}-byte offsets, expected {}", header.offsetWidth, sizeof(offset_t)));
+        if (header.adjNum != adjNum)
+            fail("corrupted adjacency array count");
+        pos = sizeof(header);
+        // Every node takes at least one offset, so n + 1 cannot wrap past this check.
+        if (header.n >= file.size)
+            fail("corrupted node count");
+        if (!fits(header.nameLen, 1))
+            fail("truncated name");
+    }
+    [[noreturn]] void fail(const std::string& reason)
+    {
+        std::string errStr = std::format("Failed to load snapshot {}: {}\n", path.string(), reason);
+        std::cerr << errStr;
+        std::terminate();
+    }
+    // Whether count values of width bytes, padded to 8, remain. count is bounded before it is
+    // multiplied, so sizes from a corrupt header cannot overflow.
+    bool fits(std::uint64_t count, std::uint64_t width) const { return count <= (file.size - pos) / width && PadTo8(count * width) <= file.size - pos; }
+    std::string readName()
+    {
+        std::string name(file.data + pos, header.nameLen);
+        pos += PadTo8(header.nameLen);
+        return name;
+    }
+    std::vector<rawID_t> readIDs()
+    {
+        if (!header.hasIDs)
+            return {};
+        if (!fits(header.n, sizeof(rawID_t)))
+            fail("truncated node IDs");
+        const rawID_t* ids = reinterpret_cast<const rawID_t*>(file.data + pos);
+        pos += header.n * sizeof(rawID_t);
+        return std::vector<rawID_t>(ids, ids + header.n);
+    }
+    CSR readAdjs()
+    {
+        const std::uint64_t n = header.n;
+        if (!fits(n + 1, sizeof(offset_t)))
+            fail("truncated offsets");
+        const offset_t* offsets = reinterpret_cast<const offset_t*>(file.data + pos);
+        pos += PadTo8((n + 1) * sizeof(offset_t));
+        if (offsets[0] != 0 || !fits(offsets[n], sizeof(node_t)))
+            fail("truncated targets");
+        if (!std::is_sorted(offsets, offsets + n + 1))
+            fail("corrupted offsets");
+        const node_t* targets = reinterpret_cast<const node_t*>(file.data + pos);
+        if (std::any_of(targets, targets + offsets[n], [n](node_t v) { return v >= n; }))
+            fail("corrupted targets");
+        // Undirected edges are stored in both directions; signed graphs split m across both arrays.
+        arcNum += offsets[n];
+        if (++adjsRead == adjNum && (arcNum % arcsPerEdge != 0 || arcNum / arcsPerEdge != header.m))
+            fail(std::format("{} arcs do not match {} edges", arcNum, header.m));
+        pos += PadTo8(offsets[n] * sizeof(node_t));
+        return CSR(std::vector<offset_t>(offsets, offsets + n + 1), std::vector<node_t>(targets, targets + offsets[n]));
+    }
+};
+
+void SimpleUndiGraph::save(const std::filesystem::path& path) const { SaveSnapshot(path, SnapshotKind::SimpleUndi, n, m, name, originalIDs, { &adjs }); }
+void SimpleDiGraph::save(const std::filesystem::path& path) const { SaveSnapshot(path, SnapshotKind::SimpleDi, n, m, name, originalIDs, { &adjs }); }
+void SignedUndiGraph::save(const std::filesystem::path& path) const { SaveSnapshot(path, SnapshotKind::SignedUndi, n, m, name, originalIDs, { &posAdjs, &negAdjs }); }
+void SignedDiGraph::save(const std::filesystem::path& path) const { SaveSnapshot(path, SnapshotKind::SignedDi, n, m, name, originalIDs, { &posAdjs, &negAdjs }); }
+
+SimpleUndiGraph SimpleUndiGraph::load(const std::filesystem::path& path)
+{
+    SnapshotReader reader(path, SnapshotKind::SimpleUndi);
+    std::string name = reader.readName();
+    std::vector<rawID_t> originalIDs = reader.readIDs();
+    CSR adjs = reader.readAdjs();
+    SimpleUndiGraph g(reader.header.n, reader.header.m, std::move(name), std::move(adjs));
+    g.originalIDs.swap(originalIDs);
+    return g;
+}
+SimpleDiGraph SimpleDiGraph::load(const std::filesystem::path& path)
+{
+    SnapshotReader reader(path, SnapshotKind::SimpleDi);
+    std::string name = reader.readName();
+    std::vector<rawID_t> originalIDs = reader.readIDs();
+    CSR adjs = reader.readAdjs();
+    SimpleDiGraph g(reader.header.n, reader.header.m, std::move(name), std::move(adjs));
+    g.originalIDs.swap(originalIDs);
+    return g;
+}
+SignedUndiGraph SignedUndiGraph::load(const std::filesystem::path& path)
+{
+    SnapshotReader reader(path, SnapshotKind::SignedUndi);
+    std::string name = reader.readName();
+    std::vector<rawID_t> originalIDs = reader.readIDs();
+    CSR posAdjs = reader.readAdjs();
+    CSR negAdjs = reader.readAdjs();
+    SignedUndiGraph g(reader.header.n, reader.header.m, std::move(name), std::move(posAdjs), std::move(negAdjs));
+    g.originalIDs.swap(originalIDs);
+    return g;
+}
+SignedDiGraph SignedDiGraph::load(const std::filesystem::path& path)
+{
+    SnapshotReader reader(path, SnapshotKind::SignedDi);
+    std::string name = reader.readName();
+    std::vector<rawID_t> originalIDs = reader.readIDs();
+    CSR posAdjs = reader.readAdjs();
+    CSR negAdjs = reader.readAdjs();
+    SignedDiGraph g(reader.header.n, reader.header.m, std::move(name), std::move(posAdjs), std::move(negAdjs));
+    g.originalIDs.swap(originalIDs);
+    return g;
+}
+}
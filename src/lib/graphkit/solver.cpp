@@ -0,0 +1,325 @@
+#include "graphkit.h"
+#include "graphkitcompact.h"
+#include "graphkitutils.h"
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <format>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using gkit::node_t, gkit::LaplacianSolver, gkit::LaplacianPreconditioner;
+using std::uint64_t;
+
+namespace {
+constexpr uint64_t solverBlockSize = 1 << 10;
+// Columns per batch. It divides 64, so the signs of a batch of sketch columns come from one hash word.
+constexpr Eigen::Index solverBatchSize = 32;
+
+// Row-major, so that the columns of a batch at one node share a cache line.
+using Block = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+// Conjugate gradients on every column of b at once, b being zero at the ground. Columns keep
+// their own step sizes and drop out as they converge. Rows are handled through raw pointers, as
+// Eigen's dynamic row expressions cost more than the few flops they wrap. The iterations run on one
+// ParallelTeam, as their passes over the rows are too short to start threads for each.
+Block RunCG(const LaplacianSolver& s, const Block& b, unsigned& iterations)
+{
+    const node_t n = s.adjs.size();
+    const Eigen::Index w = b.cols();
+    const double tol2 = s.tolerance * s.tolerance;
+    const bool ic = s.preconditioner == LaplacianPreconditioner::IncompleteCholesky;
+    const uint64_t blockNum = (uint64_t(n) + solverBlockSize - 1) / solverBlockSize;
+    Block x = Block::Zero(n, w), r = b, z(n, w), p(n, w), q(n, w);
+    auto row = [w](Block& m, uint64_t u) { return m.data() + u * w; };
+    // Inverse of the diagonal preconditioner at u; the ground row is the identity.
+    auto invDiag = [&s](uint64_t u) { return s.preconditioner == LaplacianPreconditioner::Jacobi && u != s.ground && s.degr[u] > 0 ? 1 / s.degr[u] : 1.0; };
+    ParallelTeam team(std::min<uint64_t>(gkit::GetThreadNum(), ic ? std::max<uint64_t>(blockNum, w) : blockNum));
+    // Runs f(u, acc) over all rows, acc pointing to width sums per block of rows, which sum(width)
+    // then adds in order, so the sums do not depend on the thread count.
+    Eigen::ArrayXXd partial(2 * w, blockNum);
+    auto sumRows = [&](Eigen::Index width, auto&& f) {
+        team.forEach(0, blockNum, 1, [&](uint64_t blk) {
+            double* acc = partial.col(blk).data();
+            std::fill(acc, acc + width, 0.0);
+            const uint64_t hi = std::min<uint64_t>((blk + 1) * solverBlockSize, n);
+            for (uint64_t u = blk * solverBlockSize; u < hi; u++)
+                f(u, acc);
+        });
+    };
+    auto sum = [&](Eigen::Index width) -> Eigen::ArrayXd { return partial.topRows(width).rowwise().sum(); };
+    // z = M^-1 r through the incomplete Cholesky factor, one column per task.
+    auto solveIC = [&]() {
+        team.forEach(0, w, 1, [&](uint64_t j) {
+            const Eigen::VectorXd col = r.col(j);
+            z.col(j) = s.ic.solve(col);
+        });
+    };
+    auto dotRZ = [&](uint64_t u, double* acc) {
+        const double *ru = row(r, u), *zu = row(z, u);
+        for (Eigen::Index j = 0; j < w; j++)
+            acc[j] += ru[j] * zu[j];
+    };
+    Eigen::ArrayXd bb(w), rz(w), rzNext(w), alpha(w), beta(w);
+    Eigen::Array<bool, Eigen::Dynamic, 1> active(w);
+    iterations = 0;
+    // Shared state is only written in serial steps, between the barriers of the passes that read it.
+    team.run([&](unsigned t) {
+        sumRows(w, [&](uint64_t u, double* acc) {
+            const double* ru = row(r, u);
+            for (Eigen::Index j = 0; j < w; j++)
+                acc[j] += ru[j] * ru[j];
+        });
+        team.serial(t, [&]() { bb = sum(w), active = bb > 0; });
+        if (ic)
+            solveIC();
+        sumRows(w, [&](uint64_t u, double* acc) {
+            double *zu = row(z, u), *pu = row(p, u);
+            const double* ru = row(r, u);
+            if (!ic) {
+                const double scale = invDiag(u);
+                for (Eigen::Index j = 0; j < w; j++)
+                    zu[j] = ru[j] * scale;
+            }
+            std::copy(zu, zu + w, pu);
+            dotRZ(u, acc);
+        });
+        team.serial(t, [&]() { rz = sum(w); });
+        while (active.any() && iterations < s.maxIterations) {
+            // q = L p with the ground row replaced by the identity; p stays 0 there.
+            sumRows(w, [&](uint64_t u, double* acc) {
+                double* qu = row(q, u);
+                const double* pu = row(p, u);
+                const double d = u == s.ground ? 1 : s.degr[u];
+                for (Eigen::Index j = 0; j < w; j++)
+                    qu[j] = d * pu[j];
+                if (u != s.ground)
+                    for (const node_t& v : s.adjs[u]) {
+                        const double* pv = row(p, v);
+                        for (Eigen::Index j = 0; j < w; j++)
+                            qu[j] -= pv[j];
+                    }
+                for (Eigen::Index j = 0; j < w; j++)
+                    acc[j] += pu[j] * qu[j];
+            });
+            team.serial(t, [&]() { alpha = active.select(rz / sum(w), 0.0); });
+            // Updates x and r, and with a diagonal preconditioner z as well, in one pass.
+            sumRows(2 * w, [&](uint64_t u, double* acc) {
+                double *xu = row(x, u), *ru = row(r, u), *zu = row(z, u);
+                const double *pu = row(p, u), *qu = row(q, u), scale = invDiag(u);
+                for (Eigen::Index j = 0; j < w; j++) {
+                    xu[j] += alpha[j] * pu[j], ru[j] -= alpha[j] * qu[j];
+                    acc[j] += ru[j] * ru[j];
+                    if (!ic)
+                        zu[j] = ru[j] * scale, acc[w + j] += ru[j] * zu[j];
+                }
+            });
+            team.serial(t, [&]() {
+                const Eigen::ArrayXd sums = sum(2 * w);
+                active = active && sums.head(w) > tol2 * bb;
+                rzNext = sums.tail(w);
+            });
+            if (ic) {
+                solveIC();
+                sumRows(w, dotRZ);
+                team.serial(t, [&]() { rzNext = sum(w); });
+            }
+            team.serial(t, [&]() {
+                beta = active.select(rzNext / rz, 0.0);
+                rz = rzNext;
+                iterations++;
+            });
+            team.forEach(0, n, solverBlockSize, [&](uint64_t u) {
+                double* pu = row(p, u);
+                const double* zu = row(z, u);
+                for (Eigen::Index j = 0; j < w; j++)
+                    pu[j] = zu[j] + beta[j] * pu[j];
+            });
+        }
+    });
+    return x;
+}
+
+// Solves colNum right-hand sides a batch at a time: fill(lo, b) writes columns lo.. into the
+// zeroed batch b, and take(lo, x) receives their solutions. Returns the most iterations taken by a batch.
+template <typename Fill, typename Take>
+unsigned SolveBatches(const LaplacianSolver& s, uint64_t colNum, Fill&& fill, Take&& take)
+{
+    const node_t n = s.adjs.size();
+    unsigned maxIterations = 0;
+    TickSpinner spinner("LaplacianSolver: Solving batches...", colNum);
+    for (uint64_t lo = 0; lo < colNum; lo += solverBatchSize) {
+        const Eigen::Index w = std::min<uint64_t>(solverBatchSize, colNum - lo);
+        Block b = Block::Zero(n, w);
+        fill(lo, b);
+        const Eigen::RowVectorXd mean = b.colwise().mean();
+        b.rowwise() -= mean;
+        b.row(s.ground).setZero();
+        unsigned iterations;
+        Block x = RunCG(s, b, iterations);
+        const Eigen::RowVectorXd shift = x.colwise().mean();
+        x.rowwise() -= shift;
+        take(lo, x);
+        maxIterations = std::max(maxIterations, iterations);
+        spinner.tick(w);
+    }
+    spinner.markAsCompleted();
+    return maxIterations;
+}
+
+void CheckNode(node_t u, node_t n)
+{
+    if (u >= n) {
+        std::string errStr = std::format("LaplacianSolver: node {} out of range [0, {})\n", u, n);
+        std::cerr << errStr;
+        std::terminate();
+    }
+}
+}
+
+namespace gkit {
+LaplacianSolver::LaplacianSolver(const SimpleUndiGraph& g, LaplacianPreconditioner preconditioner, double tolerance, unsigned maxIterations)
+    : adjs(g.adjs)
+    , degr(g.degrVec())
+    , ground(0)
+    , preconditioner(preconditioner)
+    , tolerance(tolerance)
+    , maxIterations(maxIterations)
+{
+    if (g.n == 0) {
+        std::cerr << "LaplacianSolver: empty graph\n";
+        std::terminate();
+    }
+    const std::vector<node_t> label = LabelCC(adjs);
+    if (std::ranges::any_of(label, [&label](node_t l) { return l != label[0]; })) {
+        std::cerr << "LaplacianSolver: graph is not connected\n";
+        std::terminate();
+    }
+    degr.maxCoeff(&ground);
+    if (preconditioner != LaplacianPreconditioner::IncompleteCholesky)
+        return;
+    // Ground row and column are replaced by the identity, as in RunCG.
+    Eigen::SparseMatrix<double> lap = Eigen::SparseMatrix<double>(g.degrMat()) - g.adjMat();
+    const Eigen::Index groundIndex = ground;
+    lap.prune([groundIndex](Eigen::Index row, Eigen::Index col, double) { return row == col || (row != groundIndex && col != groundIndex); });
+    lap.coeffRef(groundIndex, groundIndex) = 1;
+    ic.compute(lap);
+    if (ic.info() != Eigen::Success) {
+        std::cerr << "LaplacianSolver: incomplete Cholesky factorization failed\n";
+        std::terminate();
+    }
+}
+
+Eigen::MatrixXd LaplacianSolver::solve(const Eigen::MatrixXd& rhs, unsigned* iterations) const
+{
+    if (rhs.rows() != degr.size()) {
+        std::string errStr = std::format("LaplacianSolver: right-hand side has {} rows, expected {}\n", rhs.rows(), degr.size());
+        std::cerr << errStr;
+        std::terminate();
+    }
+    Eigen::MatrixXd x(rhs.rows(), rhs.cols());
+    const unsigned maxIterations = SolveBatches(
+        *this, rhs.cols(), [&](uint64_t lo, Block& b) { b = rhs.middleCols(lo, b.cols()); },
+        [&](uint64_t lo, const Block& sol) { x.middleCols(lo, sol.cols()) = sol; });
+    if (iterations != nullptr)
+        *iterations = maxIterations;
+    return x;
+}
+
+double LaplacianSolver::resistance(node_t u, node_t v) const { return resistances({ { u, v } })[0]; }
+
+std::vector<double> LaplacianSolver::resistances(const std::vector<std::pair<node_t, node_t>>& pairs) const
+{
+    for (const auto& [u, v] : pairs)
+        CheckNode(u, adjs.size()), CheckNode(v, adjs.size());
+    std::vector<double> res(pairs.size());
+    SolveBatches(
+        *this, pairs.size(),
+        [&](uint64_t lo, Block& b) {
+            for (Eigen::Index j = 0; j < b.cols(); j++)
+                b(pairs[lo + j].first, j) += 1, b(pairs[lo + j].second, j) -= 1;
+        },
+        [&](uint64_t lo, const Block& sol) {
+            for (Eigen::Index j = 0; j < sol.cols(); j++)
+                res[lo + j] = sol(pairs[lo + j].first, j) - sol(pairs[lo + j].second, j);
+        });
+    return res;
+}
+
+// L^+ e_u = L^+ (e_u - 1/n), whose entry u is L^+_uu.
+Eigen::VectorXd LaplacianSolver::pinvDiagonal() const
+{
+    Eigen::VectorXd diag(adjs.size());
+    SolveBatches(
+        *this, adjs.size(),
+        [&](uint64_t lo, Block& b) {
+            for (Eigen::Index j = 0; j < b.cols(); j++)
+                b(lo + j, j) = 1;
+        },
+        [&](uint64_t lo, const Block& sol) {
+            for (Eigen::Index j = 0; j < sol.cols(); j++)
+                diag[lo + j] = sol(lo + j, j);
+        });
+    return diag;
+}
+
+double KirchhoffIndex(const LaplacianSolver& solver) { return solver.adjs.size() * solver.pinvDiagonal().sum(); }
+
+// Expanding R(u, v) = L^+_uu + L^+_vv - 2 L^+_uv gives sum d_u L^+_uu - d^T L^+ d / 2m.
+double KemenyConstant(const LaplacianSolver& solver)
+{
+    const Eigen::VectorXd diag = solver.pinvDiagonal();
+    const Eigen::VectorXd x = solver.solve(solver.degr);
+    return solver.degr.dot(diag) - solver.degr.dot(x) / solver.degr.sum();
+}
+
+// Row i of Q W^1/2 B puts the sign s_ie of every edge e = (u, v), u < v, at u and its opposite at
+// v; s_ie is bit i of a hash of (seed, u, v), so both ends agree without numbering the edges.
+ResistanceSketch::ResistanceSketch(const LaplacianSolver& solver, unsigned k, std::uint64_t seed)
+    : z(solver.adjs.size(), k)
+    , degr(solver.degr)
+{
+    const CSR& adjs = solver.adjs;
+    const std::uint64_t key = SplitMix64(seed);
+    const double scale = 1 / std::sqrt(static_cast<double>(k));
+    SolveBatches(
+        solver, k,
+        [&](uint64_t lo, Block& b) {
+            ParallelFor(GetThreadNum(), 0, adjs.size(), solverBlockSize, [&](uint64_t u) {
+                for (const node_t& v : adjs[u]) {
+                    const uint64_t edgeKey = EdgeHash(EdgeHash(key, std::min<uint64_t>(u, v)), std::max<uint64_t>(u, v));
+                    const uint64_t word = EdgeHash(edgeKey, lo >> 6) >> (lo & 63);
+                    const double sign = u < v ? scale : -scale;
+                    for (Eigen::Index j = 0; j < b.cols(); j++)
+                        b(u, j) += ((word >> j) & 1) != 0 ? sign : -sign;
+                }
+            });
+        },
+        [&](uint64_t lo, const Block& sol) { z.middleCols(lo, sol.cols()) = sol; });
+}
+
+unsigned ResistanceSketch::dimension(node_t n, double epsilon)
+{
+    return std::ceil(4 * std::log(std::max<double>(n, 2)) / (epsilon * epsilon / 2 - epsilon * epsilon * epsilon / 3));
+}
+
+double ResistanceSketch::resistance(node_t u, node_t v) const
+{
+    CheckNode(u, z.rows()), CheckNode(v, z.rows());
+    return (z.row(u) - z.row(v)).squaredNorm();
+}
+
+// sum over unordered pairs of ||z_u - z_v||^2 = n sum ||z_u||^2 - ||sum z_u||^2.
+double ResistanceSketch::kirchhoffIndex() const { return z.rows() * z.squaredNorm() - z.colwise().sum().squaredNorm(); }
+
+// The weighted sum over ordered pairs is 4m sum d_u ||z_u||^2 - 2 ||sum d_u z_u||^2.
+double ResistanceSketch::kemenyConstant() const
+{
+    return degr.dot(z.rowwise().squaredNorm()) - (degr.transpose() * z).squaredNorm() / degr.sum();
+}
+}
@@ -0,0 +1,164 @@
+#include "graphkitcompact.h"
+#include "graphkitutils.h"
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace gkit {
+constexpr std::uint64_t transposeBlockSize = 1 << 12;
+
+template <bool Weighted>
+void CanonicalizeEdges(RawEdgeBuffer<Weighted>& raw, bool directed)
+{
+    using Edge = EdgeTuple<Weighted, rawID_t>;
+    if (!directed) {
+        for (Edge& e : raw)
+            if (std::get<0>(e) > std::get<1>(e))
+                std::swap(std::get<0>(e), std::get<1>(e));
+    }
+    std::erase_if(raw, [](const Edge& e) { return std::get<0>(e) == std::get<1>(e); });
+    auto endpoints = [](const Edge& e) { return std::make_pair(std::get<0>(e), std::get<1>(e)); };
+    if constexpr (Weighted)
+        std::ranges::stable_sort(raw, {}, endpoints);
+    else
+        std::ranges::sort(raw);
+    const auto [first, last] = std::ranges::unique(raw, {}, endpoints);
+    raw.erase(first, last);
+}
+
+template <bool Weighted>
+std::vector<rawID_t> DensifyEdges(RawEdgeBuffer<Weighted>& raw, EdgeBuffer<Weighted>& edges)
+{
+    std::vector<rawID_t> endpoints(raw.size() << 1);
+    ParallelFor(GetThreadNum(), 0, raw.size(), 1 << 16, [&](std::uint64_t i) {
+        endpoints[i << 1] = std::get<0>(raw[i]), endpoints[i << 1 | 1] = std::get<1>(raw[i]);
+    });
+    IDMap idMap(std::move(endpoints));
+    auto relabel = [&idMap](const auto& e) -> EdgeTuple<Weighted> {
+        if constexpr (Weighted)
+            return { idMap[std::get<0>(e)], idMap[std::get<1>(e)], std::get<2>(e) };
+        else
+            return { idMap[e.first], idMap[e.second] };
+    };
+    // With 64-bit node IDs the buffers have the same type, so raw is relabeled in place.
+    if constexpr (std::is_same_v<node_t, rawID_t>) {
+        edges.swap(raw);
+        ParallelFor(GetThreadNum(), 0, edges.size(), 1 << 16, [&](std::uint64_t i) { edges[i] = relabel(edges[i]); });
+    } else {
+        edges.resize(raw.size());
+        ParallelFor(GetThreadNum(), 0, edges.size(), 1 << 16, [&](std::uint64_t i) { edges[i] = relabel(raw[i]); });
+    }
+    RawEdgeBuffer<Weighted>().swap(raw);
+    return std::move(idMap.ids);
+}
+
+template <bool Weighted>
+void FilterEdges(EdgeBuffer<Weighted>& edges, const std::vector<bool>& keep, std::vector<rawID_t>& ids)
+{
+    std::vector<node_t> newID(keep.size());
+    node_t keptNum = 0;
+    for (node_t u = 0; u < keep.size(); u++) {
+        newID[u] = keep[u] ? keptNum : 0;
+        if (keep[u])
+            ids[keptNum++] = ids[u];
+    }
+    ids.resize(keptNum);
+    std::erase_if(edges, [&keep](const EdgeTuple<Weighted>& e) { return !keep[std::get<0>(e)] || !keep[std::get<1>(e)]; });
+    for (EdgeTuple<Weighted>& e : edges)
+        std::get<0>(e) = newID[std::get<0>(e)], std::get<1>(e) = newID[std::get<1>(e)];
+}
+
+template void CanonicalizeEdges<false>(RawEdgeBuffer<false>& raw, bool directed);
+template void CanonicalizeEdges<true>(RawEdgeBuffer<true>& raw, bool directed);
+template std::vector<rawID_t> DensifyEdges<false>(RawEdgeBuffer<false>& raw, EdgeBuffer<false>& edges);
+template std::vector<rawID_t> DensifyEdges<true>(RawEdgeBuffer<true>& raw, EdgeBuffer<true>& edges);
+template void FilterEdges<false>(EdgeBuffer<false>& edges, const std::vector<bool>& keep, std::vector<rawID_t>& ids);
+template void FilterEdges<true>(EdgeBuffer<true>& edges, const std::vector<bool>& keep, std::vector<rawID_t>& ids);
+
+CSRFiller::CSRFiller(CSR& csr, std::vector<node_t>&& degr)
+    : csr(csr)
+    , next(degr.size())
+{
+    const node_t n = degr.size();
+    std::uint64_t total = 0;
+    for (const node_t& d : degr)
+        total += d;
+    CheckIndexRange<offset_t>(total, "Adjacency size");
+    csr.offsets.assign(n + 1, 0);
+    for (node_t u = 0; u < n; u++)
+        csr.offsets[u + 1] = csr.offsets[u] + degr[u];
+    std::vector<node_t>().swap(degr);
+    csr.targets.resize(csr.offsets[n]);
+    std::copy(csr.offsets.begin(), csr.offsets.end() - 1, next.begin());
+}
+
+// Parallel counting sort. Edges are first scattered into a buffer grouped by ranges of targets,
+// blocks of sources being kept in order, then every target range is counting-sorted on its own.
+// Sources reach each target in increasing order, so the lists come out sorted.
+CSR Transpose(const CSR& adjs)
+{
+    const node_t n = adjs.size();
+    const unsigned threadNum = GetThreadNum();
+    CSR invAdjs;
+    if (threadNum <= 1 || n == 0) {
+        std::vector<node_t> degr(n);
+        for (const node_t& v : adjs.targets)
+            degr[v]++;
+        CSRFiller filler(invAdjs, std::move(degr));
+        for (node_t u = 0; u < n; u++)
+            for (const node_t& v : adjs[u])
+                filler.add(v, u);
+        return invAdjs;
+    }
+    const std::uint64_t m = adjs.targets.size(), partNum = std::uint64_t(threadNum) * 4;
+    const std::uint64_t partSize = (n + partNum - 1) / partNum;
+    // Source blocks hold about m / partNum edges each.
+    std::vector<node_t> blockBegin(partNum + 1, n);
+    for (std::uint64_t b = 0; b < partNum; b++)
+        blockBegin[b] = std::ranges::lower_bound(adjs.offsets, m * b / partNum) - adjs.offsets.begin();
+    std::vector<offset_t> pos(partNum * partNum);
+    ParallelFor(threadNum, 0, partNum, 1, [&](std::uint64_t b) {
+        for (node_t u = blockBegin[b]; u < blockBegin[b + 1]; u++)
+            for (const node_t& v : adjs[u])
+                pos[b * partNum + v / partSize]++;
+    });
+    std::vector<offset_t> partBegin(partNum + 1);
+    for (std::uint64_t p = 0; p < partNum; p++) {
+        partBegin[p + 1] = partBegin[p];
+        for (std::uint64_t b = 0; b < partNum; b++) {
+            const offset_t c = pos[b * partNum + p];
+            pos[b * partNum + p] = partBegin[p + 1];
+            partBegin[p + 1] += c;
+        }
+    }
+    std::vector<std::pair<node_t, node_t>> buffer(m);
+    ParallelFor(threadNum, 0, partNum, 1, [&](std::uint64_t b) {
+        for (node_t u = blockBegin[b]; u < blockBegin[b + 1]; u++)
+            for (const node_t& v : adjs[u])
+                buffer[pos[b * partNum + v / partSize]++] = { u, v };
+    });
+    invAdjs.offsets.resize(n + 1);
+    invAdjs.targets.resize(m);
+    ParallelFor(threadNum, 0, partNum, 1, [&](std::uint64_t p) {
+        const node_t lo = std::min<std::uint64_t>(p * partSize, n), hi = std::min<std::uint64_t>(lo + partSize, n);
+        if (lo == hi)
+            return;
+        std::vector<offset_t> next(hi - lo);
+        for (offset_t i = partBegin[p]; i < partBegin[p + 1]; i++)
+            next[buffer[i].second - lo]++;
+        offset_t begin = partBegin[p];
+        for (node_t v = lo; v < hi; v++) {
+            const offset_t degr = next[v - lo];
+            invAdjs.offsets[v] = next[v - lo] = begin;
+            begin += degr;
+        }
+        for (offset_t i = partBegin[p]; i < partBegin[p + 1]; i++)
+            invAdjs.targets[next[buffer[i].second - lo]++] = buffer[i].first;
+    });
+    invAdjs.offsets[n] = m;
+    return invAdjs;
+}
+}
@@ -0,0 +1,294 @@
+#include "graphkit.h"
+#include "graphkitcompact.h"
+#include "graphkitutils.h"
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <initializer_list>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using gkit::node_t, gkit::rawID_t, gkit::weight_t, gkit::CSR;
+
+namespace {
+constexpr std::uint64_t splitBlockSize = 1 << 12;
+
+std::pair<node_t, node_t> Endpoints(const std::pair<node_t, node_t>& e) { return e; }
+std::pair<node_t, node_t> Endpoints(const std::pair<const std::pair<node_t, node_t>, weight_t>& e) { return e.first; }
+node_t Target(node_t v) { return v; }
+node_t Target(const std::pair<node_t, weight_t>& e) { return e.first; }
+
+// Adjacency array of a raw undirected graph on the ranks of its node IDs, keeping the edges e with keep(e).
+// The edges are sorted with u < v, so appending both directions in order leaves every list sorted.
+template <typename Graph, typename Keep>
+CSR RawUndiAdjs(const Graph& g, const gkit::IDMap& idMap, Keep&& keep)
+{
+    std::vector<node_t> degr(idMap.size());
+    for (const auto& e : g.edges) {
+        if (!keep(e))
+            continue;
+        const auto [u, v] = Endpoints(e);
+        degr[idMap[u]]++, degr[idMap[v]]++;
+    }
+    CSR adjs;
+    gkit::CSRFiller filler(adjs, std::move(degr));
+    for (const auto& e : g.edges) {
+        if (!keep(e))
+            continue;
+        const auto [u, v] = Endpoints(e);
+        const node_t newU = idMap[u], newV = idMap[v];
+        filler.add(newU, newV), filler.add(newV, newU);
+    }
+    return adjs;
+}
+// Same for a raw directed graph, whose lists are kept in insertion order and sorted afterwards.
+template <typename Graph, typename Keep>
+CSR RawDiAdjs(const Graph& g, const gkit::IDMap& idMap, Keep&& keep)
+{
+    std::vector<node_t> degr;
+    degr.reserve(idMap.size());
+    for (const auto& [u, adj] : g.adjs)
+        degr.push_back(std::ranges::count_if(adj, keep));
+    CSR adjs;
+    gkit::CSRFiller filler(adjs, std::move(degr));
+    node_t i = 0;
+    for (const auto& [u, adj] : g.adjs) {
+        for (const auto& e : adj)
+            if (keep(e))
+                filler.add(i, idMap[Target(e)]);
+        std::ranges::sort(adjs[i++]);
+    }
+    return adjs;
+}
+template <typename Graph>
+std::vector<rawID_t> RawDiIDs(const Graph& g)
+{
+    std::vector<rawID_t> ids;
+    ids.reserve(g.adjs.size());
+    for (const auto& [u, adj] : g.adjs)
+        ids.push_back(u);
+    return ids;
+}
+auto keepAll = [](const auto&) { return true; };
+auto keepPositive = [](const auto& e) { return e.second > 0; };
+auto keepNegative = [](const auto& e) { return e.second <= 0; };
+
+template <typename Graph>
+gkit::Components RawCC(const Graph& g)
+{
+    gkit::IDMap idMap(std::vector<rawID_t>(g.nodes.begin(), g.nodes.end()), true);
+    std::vector<std::pair<node_t, node_t>> edges;
+    edges.reserve(g.edges.size());
+    for (const auto& e : g.edges)
+        edges.push_back(Endpoints(e));
+    ParallelFor(gkit::GetThreadNum(), 0, edges.size(), gkit::ConcurrentDSU::blockSize, [&](std::uint64_t i) {
+        edges[i] = { idMap[edges[i].first], idMap[edges[i].second] };
+    });
+    gkit::ConcurrentDSU dsu(idMap.size());
+    dsu.unionEdges(edges);
+    gkit::Components comps = gkit::RankLabels(dsu.labels());
+    comps.nodes = std::move(idMap.ids);
+    return comps;
+}
+template <typename Graph>
+gkit::Components RawSCC(const Graph& g)
+{
+    gkit::IDMap idMap(RawDiIDs(g), true);
+    gkit::Components comps = gkit::RankLabels(gkit::LabelSCC(RawDiAdjs(g, idMap, keepAll)));
+    comps.nodes = std::move(idMap.ids);
+    return comps;
+}
+
+// Wraps the arrays of SplitComponents into graphs of type T. sourceIDs holds the original ID of
+// every node labeled by comps, or is empty if the labeled IDs are the original ones.
+template <typename T>
+std::vector<T> MakeComponents(const std::string& name, const gkit::Components& comps, const std::vector<rawID_t>& sourceIDs, std::vector<std::vector<CSR>>&& parts)
+{
+    constexpr bool directed = std::is_same_v<T, gkit::SimpleDiGraph> || std::is_same_v<T, gkit::SignedDiGraph>;
+    std::vector<T> graphs;
+    graphs.reserve(parts.size());
+    for (std::vector<CSR>& adjs : parts) {
+        std::uint64_t m = 0;
+        for (const CSR& csr : adjs)
+            m += csr.targets.size();
+        if (!directed)
+            m >>= 1;
+        const node_t n = adjs[0].size();
+        std::string newName = std::format("{}_{}{}", name, directed ? "SCC" : "CC", graphs.size());
+        if constexpr (std::is_same_v<T, gkit::SimpleUndiGraph> || std::is_same_v<T, gkit::SimpleDiGraph>)
+            graphs.emplace_back(n, m, std::move(newName), std::move(adjs[0]));
+        else
+            graphs.emplace_back(n, m, std::move(newName), std::move(adjs[0]), std::move(adjs[1]));
+    }
+    for (node_t u = 0; u < comps.componentID.size(); u++)
+        if (comps.componentID[u] < graphs.size())
+            graphs[comps.componentID[u]].originalIDs.push_back(sourceIDs.empty() ? u : sourceIDs[u]);
+    return graphs;
+}
+}
+
+namespace gkit {
+node_t Components::componentOf(node_t u) const { return componentID[nodes.empty() ? u : std::ranges::lower_bound(nodes, u) - nodes.begin()]; }
+std::map<node_t, node_t> Components::sizeHistogram() const
+{
+    std::map<node_t, node_t> histogram;
+    for (const node_t& size : sizes)
+        histogram[size]++;
+    return histogram;
+}
+
+// Labels are first numbered by their smallest node, then stably sorted by size.
+Components RankLabels(const std::vector<node_t>& label)
+{
+    constexpr node_t noID = std::numeric_limits<node_t>::max();
+    const node_t n = label.size();
+    Components comps;
+    std::vector<node_t> firstID(n, noID);
+    comps.componentID.resize(n);
+    for (node_t u = 0; u < n; u++) {
+        node_t& id = firstID[label[u]];
+        if (id == noID)
+            id = comps.sizes.size(), comps.sizes.push_back(0);
+        comps.componentID[u] = id;
+        comps.sizes[id]++;
+    }
+    std::vector<node_t> order(comps.sizes.size()), rank(comps.sizes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, std::greater {}, [&comps](node_t id) { return comps.sizes[id]; });
+    for (node_t i = 0; i < order.size(); i++)
+        rank[order[i]] = i;
+    ParallelFor(GetThreadNum(), 0, n, ConcurrentDSU::blockSize, [&](std::uint64_t u) { comps.componentID[u] = rank[comps.componentID[u]]; });
+    std::vector<node_t> sizes(order.size());
+    for (node_t i = 0; i < order.size(); i++)
+        sizes[i] = comps.sizes[order[i]];
+    comps.sizes.swap(sizes);
+    return comps;
+}
+std::vector<bool> LargestLabel(const std::vector<node_t>& label)
+{
+    const Components comps = RankLabels(label);
+    std::vector<bool> inLargest(label.size());
+    for (node_t u = 0; u < label.size(); u++)
+        inLargest[u] = comps.componentID[u] == 0;
+    return inLargest;
+}
+
+CSR MergeCSR(const CSR& adjs1, const CSR& adjs2)
+{
+    const node_t n = adjs1.size();
+    std::vector<node_t> degr(n);
+    for (node_t u = 0; u < n; u++)
+        degr[u] = adjs1.degree(u) + adjs2.degree(u);
+    CSR adjs;
+    CSRFiller filler(adjs, std::move(degr));
+    for (const CSR* csr : { &adjs1, &adjs2 })
+        ParallelFor(GetThreadNum(), 0, n, splitBlockSize, [&](std::uint64_t u) {
+            for (const node_t& v : (*csr)[u])
+                filler.add(u, v);
+        });
+    return adjs;
+}
+
+std::vector<std::vector<CSR>> SplitComponents(const Components& comps, node_t k, std::initializer_list<const CSR*> adjs)
+{
+    k = std::min(k, comps.componentNum());
+    const std::vector<node_t>& id = comps.componentID;
+    const node_t n = id.size();
+    std::vector<node_t> newID(n), count(k);
+    for (node_t u = 0; u < n; u++)
+        if (id[u] < k)
+            newID[u] = count[id[u]]++;
+    std::vector<std::vector<CSR>> parts(k, std::vector<CSR>(adjs.size()));
+    std::size_t j = 0;
+    for (const CSR* csr : adjs) {
+        std::vector<std::vector<node_t>> degr(k);
+        for (node_t c = 0; c < k; c++)
+            degr[c].resize(count[c]);
+        auto inSame = [&id](node_t u) { return [&id, c = id[u]](node_t v) { return id[v] == c; }; };
+        ParallelFor(GetThreadNum(), 0, n, splitBlockSize, [&](std::uint64_t u) {
+            if (id[u] < k)
+                degr[id[u]][newID[u]] = std::ranges::count_if((*csr)[u], inSame(u));
+        });
+        std::vector<CSRFiller> fillers;
+        fillers.reserve(k);
+        for (node_t c = 0; c < k; c++)
+            fillers.emplace_back(parts[c][j], std::move(degr[c]));
+        // Every node only fills its own list, so the nodes can be processed in parallel.
+        ParallelFor(GetThreadNum(), 0, n, splitBlockSize, [&](std::uint64_t u) {
+            if (id[u] >= k)
+                return;
+            for (const node_t& v : (*csr)[u])
+                if (id[v] == id[u])
+                    fillers[id[u]].add(newID[u], newID[v]);
+        });
+        j++;
+    }
+    return parts;
+}
+
+std::vector<node_t> LabelCC(const CSR& adjs)
+{
+    ConcurrentDSU dsu(adjs.size());
+    dsu.unionAll(adjs.size(), [&](std::uint64_t u) {
+        for (const node_t& v : adjs[u])
+            if (u < v)
+                dsu.setUnion(u, v);
+    });
+    return dsu.labels();
+}
+
+Components FindComponents(const UnweightedUndiGraph& g) { return RawCC(g); }
+Components FindComponents(const UnweightedDiGraph& g) { return RawSCC(g); }
+Components FindComponents(const WeightedUndiGraph& g) { return RawCC(g); }
+Components FindComponents(const WeightedDiGraph& g) { return RawSCC(g); }
+Components FindComponents(const SimpleUndiGraph& g) { return RankLabels(LabelCC(g.adjs)); }
+Components FindComponents(const SimpleDiGraph& g) { return RankLabels(LabelSCC(g.adjs)); }
+Components FindComponents(const SignedUndiGraph& g) { return RankLabels(LabelCC(MergeCSR(g.posAdjs, g.negAdjs))); }
+Components FindComponents(const SignedDiGraph& g) { return RankLabels(LabelSCC(MergeCSR(g.posAdjs, g.negAdjs))); }
+
+std::vector<SimpleUndiGraph> TopComponents(const UnweightedUndiGraph& g, const Components& comps, node_t k)
+{
+    const IDMap idMap(std::vector<rawID_t>(comps.nodes), true);
+    const CSR adjs = RawUndiAdjs(g, idMap, keepAll);
+    return MakeComponents<SimpleUndiGraph>(g.name, comps, comps.nodes, SplitComponents(comps, k, { &adjs }));
+}
+std::vector<SimpleDiGraph> TopComponents(const UnweightedDiGraph& g, const Components& comps, node_t k)
+{
+    const IDMap idMap(std::vector<rawID_t>(comps.nodes), true);
+    const CSR adjs = RawDiAdjs(g, idMap, keepAll);
+    return MakeComponents<SimpleDiGraph>(g.name, comps, comps.nodes, SplitComponents(comps, k, { &adjs }));
+}
+std::vector<SignedUndiGraph> TopComponents(const WeightedUndiGraph& g, const Components& comps, node_t k)
+{
+    const IDMap idMap(std::vector<rawID_t>(comps.nodes), true);
+    const CSR posAdjs = RawUndiAdjs(g, idMap, keepPositive), negAdjs = RawUndiAdjs(g, idMap, keepNegative);
+    return MakeComponents<SignedUndiGraph>(g.name, comps, comps.nodes, SplitComponents(comps, k, { &posAdjs, &negAdjs }));
+}
+std::vector<SignedDiGraph> TopComponents(const WeightedDiGraph& g, const Components& comps, node_t k)
+{
+    const IDMap idMap(std::vector<rawID_t>(comps.nodes), true);
+    const CSR posAdjs = RawDiAdjs(g, idMap, keepPositive), negAdjs = RawDiAdjs(g, idMap, keepNegative);
+    return MakeComponents<SignedDiGraph>(g.name, comps, comps.nodes, SplitComponents(comps, k, { &posAdjs, &negAdjs }));
+}
+std::vector<SimpleUndiGraph> TopComponents(const SimpleUndiGraph& g, const Components& comps, node_t k)
+{
+    return MakeComponents<SimpleUndiGraph>(g.name, comps, g.originalIDs, SplitComponents(comps, k, { &g.adjs }));
+}
+std::vector<SimpleDiGraph> TopComponents(const SimpleDiGraph& g, const Components& comps, node_t k)
+{
+    return MakeComponents<SimpleDiGraph>(g.name, comps, g.originalIDs, SplitComponents(comps, k, { &g.adjs }));
+}
+std::vector<SignedUndiGraph> TopComponents(const SignedUndiGraph& g, const Components& comps, node_t k)
+{
+    return MakeComponents<SignedUndiGraph>(g.name, comps, g.originalIDs, SplitComponents(comps, k, { &g.posAdjs, &g.negAdjs }));
+}
+std::vector<SignedDiGraph> TopComponents(const SignedDiGraph& g, const Components& comps, node_t k)
+{
+    return MakeComponents<SignedDiGraph>(g.name, comps, g.originalIDs, SplitComponents(comps, k, { &g.posAdjs, &g.negAdjs }));
+}
+}
@@ -1,7 +1,35 @@
 #include "graphkit.h"
-#include <algorithm>
-#include <iterator>
+#include "graphkitcompact.h"
+#include "graphkitutils.h"
+#include <cstdint>
+#include <string>
 #include <utility>
+#include <vector>
+
+using gkit::node_t, gkit::rawID_t, gkit::CSR;
+
+namespace {
+// Copies the lists served by the view, which are sorted.
+CSR ExpansionAdjs(const gkit::ExpansionView& view)
+{
+    std::vector<node_t> degr(view.nodeNum());
+    for (node_t u = 0; u < view.nodeNum(); u++)
+        degr[u] = view.degree(u);
+    CSR adjs;
+    gkit::CSRFiller filler(adjs, std::move(degr));
+    ParallelFor(gkit::GetThreadNum(), 0, view.nodeNum(), 1 << 12, [&](std::uint64_t u) {
+        view.forEachNeighbor(u, [&](node_t v) { filler.add(u, v); });
+    });
+    return adjs;
+}
+// Both copies of a node stand for the same source node.
+std::vector<rawID_t> ExpansionIDs(const std::vector<rawID_t>& originalIDs)
+{
+    std::vector<rawID_t> ids(originalIDs);
+    ids.insert(ids.end(), originalIDs.begin(), originalIDs.end());
+    return ids;
+}
+}
 
 namespace gkit {
 SimpleUndiGraph::SimpleUndiGraph(SignedUndiGraph&& g)
@@ -9,58 +37,59 @@ SimpleUndiGraph::SimpleUndiGraph(SignedUndiGraph&& g)
     SimpleUndiGraph expansG = g.expansion();
     n = expansG.n, m = expansG.m;
     name.swap(expansG.name);
-    adjs.swap(expansG.adjs);
+    std::swap(adjs, expansG.adjs);
+    originalIDs.swap(expansG.originalIDs);
     std::string nullName;
-    std::vector<std::vector<node_t>> posAdjs, negAdjs;
+    CSR posAdjs, negAdjs;
+    std::vector<rawID_t> nullIDs;
     nullName.swap(g.name);
-    posAdjs.swap(g.posAdjs), negAdjs.swap(g.negAdjs);
+    std::swap(posAdjs, g.posAdjs), std::swap(negAdjs, g.negAdjs);
+    nullIDs.swap(g.originalIDs);
 }
 SimpleDiGraph::SimpleDiGraph(SignedDiGraph&& g)
 {
     SimpleDiGraph expansG = g.expansion();
     n = expansG.n, m = expansG.m;
     name.swap(expansG.name);
-    adjs.swap(expansG.adjs);
+    std::swap(adjs, expansG.adjs);
+    originalIDs.swap(expansG.originalIDs);
     std::string nullName;
-    std::vector<std::vector<node_t>> posAdjs, negAdjs;
+    CSR posAdjs, negAdjs;
+    std::vector<rawID_t> nullIDs;
     nullName.swap(g.name);
-    posAdjs.swap(g.posAdjs), negAdjs.swap(g.negAdjs);
+    std::swap(posAdjs, g.posAdjs), std::swap(negAdjs, g.negAdjs);
+    nullIDs.swap(g.originalIDs);
+}
+
+ExpansionView::ExpansionView(const SignedUndiGraph& g)
+    : n(g.n)
+    , posAdjs(g.posAdjs)
+    , negAdjs(g.negAdjs)
+    , symmetric(true)
+{
+}
+ExpansionView::ExpansionView(const SignedDiGraph& g)
+    : n(g.n)
+    , posAdjs(g.posAdjs)
+    , negAdjs(g.negAdjs)
+    , symmetric(false)
+{
 }
 
 SimpleUndiGraph SignedUndiGraph::expansion() const
 {
     std::string newName(name);
-    std::vector<std::vector<node_t>> adjs(n << 1);
     newName.append("_expansion");
-    const node_t nodeNum = n;
-    auto duplic = [&nodeNum](const node_t& i) { return i + nodeNum; };
-    for (node_t u = 0; u < nodeNum; u++) {
-        adjs[u].reserve(posAdjs[u].size() + negAdjs[u].size());
-        std::ranges::copy(posAdjs[u], std::back_inserter(adjs[u]));
-        std::ranges::transform(negAdjs[u], std::back_inserter(adjs[u]), duplic);
-        const node_t dupU = u + nodeNum;
-        adjs[dupU].reserve(posAdjs[u].size() + negAdjs[u].size());
-        std::ranges::copy(negAdjs[u], std::back_inserter(adjs[dupU]));
-        std::ranges::transform(posAdjs[u], std::back_inserter(adjs[dupU]), duplic);
-    }
-    return SimpleUndiGraph(n << 1, m << 1, std::move(newName), std::move(adjs));
+    SimpleUndiGraph expansG(n << 1, m << 1, std::move(newName), ExpansionAdjs(expansionView()));
+    expansG.originalIDs = ExpansionIDs(originalIDs);
+    return expansG;
 }
 SimpleDiGraph SignedDiGraph::expansion() const
 {
     std::string newName(name);
-    std::vector<std::vector<node_t>> adjs(n << 1);
     newName.append("_expansion");
-    const node_t nodeNum = n;
-    auto duplic = [&nodeNum](const node_t& i) { return i + nodeNum; };
-    for (node_t u = 0; u < nodeNum; u++) {
-        adjs[u].reserve(posAdjs[u].size() + negAdjs[u].size());
-        std::ranges::copy(posAdjs[u], std::back_inserter(adjs[u]));
-        std::ranges::transform(negAdjs[u], std::back_inserter(adjs[u]), duplic);
-        const node_t dupU = u + nodeNum;
-        adjs[dupU].reserve(posAdjs[u].size() + negAdjs[u].size());
-        std::ranges::copy(negAdjs[u], std::back_inserter(adjs[dupU]));
-        std::ranges::transform(posAdjs[u], std::back_inserter(adjs[dupU]), duplic);
-    }
-    return SimpleDiGraph(n << 1, m << 1, std::move(newName), std::move(adjs));
+    SimpleDiGraph expansG(n << 1, m << 1, std::move(newName), ExpansionAdjs(expansionView()));
+    expansG.originalIDs = ExpansionIDs(originalIDs);
+    return expansG;
+}
 }
-}
\ No newline at end of file
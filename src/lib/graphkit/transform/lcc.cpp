@@ -1,123 +1,53 @@
 #include "graphkit.h"
+#include "graphkitcompact.h"
 #include "graphkitutils.h"
 #include <algorithm>
 #include <cstdint>
+#include <format>
 #include <iterator>
+#include <set>
 #include <tuple>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
-using gkit::node_t, gkit::weight_t;
-using std::uint64_t;
+using gkit::node_t, gkit::rawID_t, gkit::weight_t;
 
-struct DSUEntry {
-    bool isRoot;
-    uint64_t val;
-};
-
-struct DSU {
-    std::unordered_map<node_t, DSUEntry> parent;
-    DSU() = default;
-    DSU(gkit::UnweightedUndiGraph& g)
-    {
-        TickSpinner spinner1("LCC: Adding elements to DSU...", g.nodes.size());
-        for (const node_t u : g.nodes) {
-            add(u);
-            spinner1.tick();
-        }
-        spinner1.markAsCompleted();
-        TickSpinner spinner2("LCC: Performing setUnion...", g.edges.size());
-        for (const auto [u, v] : g.edges) {
-            setUnion(u, v);
-            spinner2.tick();
-        }
-        spinner2.markAsCompleted();
-    }
-    DSU(gkit::WeightedUndiGraph& g)
-    {
-        TickSpinner spinner1("LCC: Adding elements to DSU...", g.nodes.size());
-        for (const node_t u : g.nodes) {
-            add(u);
-            spinner1.tick();
-        }
-        spinner1.markAsCompleted();
-        TickSpinner spinner2("LCC: Performing setUnion...", g.edges.size());
-        for (const std::pair<std::pair<node_t, node_t>, weight_t>& p : g.edges) {
-            const auto [u, v] = p.first;
-            setUnion(u, v);
-            spinner2.tick();
-        }
-        spinner2.markAsCompleted();
-    }
-    void add(node_t u) { parent.insert({ u, { true, 1ull } }); }
-    node_t find(node_t u)
-    {
-        if (parent[u].isRoot)
-            return u;
-        node_t f = parent[u].val;
-        f = find(f);
-        parent[u].val = f;
-        return f;
-    }
-    std::pair<node_t, uint64_t> findAll(node_t u)
-    {
-        if (parent[u].isRoot)
-            return { u, parent[u].val };
-        node_t f = parent[u].val;
-        uint64_t fNum;
-        std::tie(f, fNum) = findAll(f);
-        parent[u].val = f;
-        return { f, fNum };
-    }
-    bool setUnion(node_t u, node_t v)
-    {
-        u = find(u), v = find(v);
-        if (u == v)
-            return false;
-        uint64_t uNum = parent[u].val, vNum = parent[v].val;
-        if (uNum < vNum) {
-            parent[u] = { false, v };
-            parent[v].val = uNum + vNum;
-        } else {
-            parent[v] = { false, u };
-            parent[u].val = uNum + vNum;
-        }
-        return true;
-    }
-    node_t maxKey()
-    {
-        return std::ranges::max_element(parent, [](const std::pair<node_t, DSUEntry>& p1, const std::pair<node_t, DSUEntry>& p2) {
-            uint64_t p1Size = p1.second.isRoot ? p1.second.val : 0;
-            uint64_t p2Size = p2.second.isRoot ? p2.second.val : 0;
-            return p1Size < p2Size;
-        })->first;
-    }
-};
+// Reduces raw to its LCC, moved into edges with nodes numbered 0..n-1, and returns the original IDs
+// of the n nodes. Every node is kept under the other policies.
+template <bool Weighted>
+std::vector<rawID_t> CompactLCC(gkit::RawEdgeBuffer<Weighted>& raw, gkit::EdgeBuffer<Weighted>& edges, gkit::ComponentPolicy policy)
+{
+    gkit::CanonicalizeEdges<Weighted>(raw, false);
+    std::vector<rawID_t> ids = gkit::DensifyEdges<Weighted>(raw, edges);
+    if (policy != gkit::ComponentPolicy::Largest)
+        return ids;
+    gkit::ConcurrentDSU dsu(ids.size());
+    dsu.unionEdges(edges);
+    gkit::FilterEdges<Weighted>(edges, gkit::LargestLabel(dsu.labels()), ids);
+    return ids;
+}
 
 namespace gkit {
 UnweightedUndiGraph UnweightedUndiGraph::LCC()
 {
-    DSU dsu(*this);
-    node_t rootLCC = dsu.maxKey();
+    const Components comps = FindComponents(*this);
     std::string newName(name);
     newName.append("_LCC");
     std::set<node_t> newNodes;
     std::set<std::pair<node_t, node_t>> newEdges;
-    auto inLCC = [&dsu, &rootLCC](node_t u) { return dsu.find(u) == rootLCC; };
+    auto inLCC = [&comps](node_t u) { return comps.componentOf(u) == 0; };
     std::ranges::copy_if(nodes, std::inserter(newNodes, newNodes.end()), inLCC);
     std::ranges::copy_if(edges, std::inserter(newEdges, newEdges.end()), [&inLCC](std::pair<node_t, node_t> e) { return inLCC(e.first) && inLCC(e.second); });
     return UnweightedUndiGraph(std::move(newName), std::move(newNodes), std::move(newEdges));
 }
 WeightedUndiGraph WeightedUndiGraph::LCC()
 {
-    DSU dsu(*this);
-    node_t rootLCC = dsu.maxKey();
+    const Components comps = FindComponents(*this);
     std::string newName(name);
     newName.append("_LCC");
     std::set<node_t> newNodes;
     std::map<std::pair<node_t, node_t>, weight_t> newEdges;
-    auto inLCC = [&dsu, &rootLCC](node_t u) { return dsu.find(u) == rootLCC; };
+    auto inLCC = [&comps](node_t u) { return comps.componentOf(u) == 0; };
     std::ranges::copy_if(nodes, std::inserter(newNodes, newNodes.end()), inLCC);
     std::ranges::copy_if(edges, std::inserter(newEdges, newEdges.end()), [&inLCC](std::pair<std::pair<node_t, node_t>, weight_t> p) {
         const auto [u, v] = p.first;
@@ -126,106 +56,146 @@ WeightedUndiGraph WeightedUndiGraph::LCC()
     return WeightedUndiGraph(std::move(newName), std::move(newNodes), std::move(newEdges));
 }
 
-SimpleUndiGraph::SimpleUndiGraph(UnweightedUndiGraph&& g)
+SimpleUndiGraph::SimpleUndiGraph(UnweightedUndiGraph&& g, ComponentPolicy policy)
     : name(std::move(g.name))
 {
-    DSU dsu(g);
-    node_t rootLCC = dsu.maxKey();
-    auto outOfLCC = [&dsu, &rootLCC](node_t u) { return dsu.find(u) != rootLCC; };
-    std::erase_if(g.nodes, outOfLCC);
-    std::erase_if(g.edges, [&outOfLCC](std::pair<node_t, node_t> e) { return outOfLCC(e.first) || outOfLCC(e.second); });
+    if (policy == ComponentPolicy::Largest) {
+        const Components comps = FindComponents(g);
+        auto outOfLCC = [&comps](node_t u) { return comps.componentOf(u) != 0; };
+        std::erase_if(g.nodes, outOfLCC);
+        std::erase_if(g.edges, [&outOfLCC](std::pair<node_t, node_t> e) { return outOfLCC(e.first) || outOfLCC(e.second); });
+    } else {
+        // Full keeps the nodes with an edge; isolated ones can only come from addNode.
+        std::set<node_t> linked;
+        for (const auto& [u, v] : g.edges)
+            linked.insert(u), linked.insert(v);
+        g.nodes.swap(linked);
+    }
     n = g.nodeNum();
     m = g.edgeNum();
-    std::unordered_map<node_t, node_t> o2n;
-    bool renumber = *std::ranges::max_element(g.nodes) != n - 1;
-    adjs.assign(n, {});
+    IDMap idMap(std::vector<rawID_t>(g.nodes.begin(), g.nodes.end()), true);
+    std::vector<node_t> degr(n);
+    for (const auto [u, v] : g.edges)
+        degr[idMap[u]]++, degr[idMap[v]]++;
+    // The edges are sorted with u < v and relabeling keeps the order, so every list comes out sorted.
+    CSRFiller filler(adjs, std::move(degr));
     TickSpinner spinner("SimpleUndiGraph: Computing adjacency list...", m);
-    if (renumber) {
-        for (const node_t& u : g.nodes)
-            o2n[u] = o2n.size();
-        for (const auto [u, v] : g.edges) {
-            node_t newU = o2n[u], newV = o2n[v];
-            adjs[newU].push_back(newV), adjs[newV].push_back(newU);
-            spinner.tick();
-        }
-    } else {
-        for (const auto [u, v] : g.edges) {
-            adjs[u].push_back(v), adjs[v].push_back(u);
-            spinner.tick();
-        }
+    for (const auto [u, v] : g.edges) {
+        const node_t newU = idMap[u], newV = idMap[v];
+        filler.add(newU, newV), filler.add(newV, newU);
+        spinner.tick();
     }
     spinner.markAsCompleted();
-    for (node_t u = 0; u < n; u++)
-        std::ranges::sort(adjs[u]);
+    originalIDs = std::move(idMap.ids);
     std::set<node_t> nodes;
     std::set<std::pair<node_t, node_t>> edges;
     nodes.swap(g.nodes);
     edges.swap(g.edges);
 }
-SimpleUndiGraph::SimpleUndiGraph(std::string&& name, std::istream& in)
-    : SimpleUndiGraph(UnweightedUndiGraph(std::move(name), in))
+// The edges of the buffer are sorted by (u, v) with u < v, so appending both directions
+// in buffer order leaves every adjacency list sorted.
+SimpleUndiGraph::SimpleUndiGraph(std::string&& name, std::vector<std::pair<rawID_t, rawID_t>>&& rawEdges, ComponentPolicy policy)
+    : name(name)
+{
+    EdgeBuffer<false> edges;
+    originalIDs = CompactLCC<false>(rawEdges, edges, policy);
+    n = originalIDs.size();
+    m = edges.size();
+    std::vector<node_t> degr(n);
+    for (const auto& [u, v] : edges)
+        degr[u]++, degr[v]++;
+    CSRFiller filler(adjs, std::move(degr));
+    TickSpinner spinner("SimpleUndiGraph: Computing adjacency list...", m);
+    for (const auto& [u, v] : edges) {
+        filler.add(u, v), filler.add(v, u);
+        spinner.tick();
+    }
+    spinner.markAsCompleted();
+}
+SimpleUndiGraph::SimpleUndiGraph(std::string&& name, std::istream& in, ComponentPolicy policy)
+    : SimpleUndiGraph(std::move(name), ReadEdgeBuffer<false>(in, std::format("Reading SimpleUndiGraph {}", name)), policy)
 {
 }
-SimpleUndiGraph::SimpleUndiGraph(std::string&& name, const std::filesystem::path& source)
-    : SimpleUndiGraph(UnweightedUndiGraph(std::move(name), source))
+SimpleUndiGraph::SimpleUndiGraph(std::string&& name, const std::filesystem::path& source, ComponentPolicy policy)
+    : SimpleUndiGraph(std::move(name), ReadEdgeBuffer<false>(source, std::format("Reading SimpleUndiGraph {}", name)), policy)
+{
+}
+SimpleUndiGraph::SimpleUndiGraph(std::string&& name, EdgeStream& in, ComponentPolicy policy)
+    : SimpleUndiGraph(std::move(name), ReadEdgeBuffer<false>(in, std::format("Reading SimpleUndiGraph {}", name)), policy)
 {
 }
 
-SignedUndiGraph::SignedUndiGraph(WeightedUndiGraph&& g)
+SignedUndiGraph::SignedUndiGraph(WeightedUndiGraph&& g, ComponentPolicy policy)
     : name(std::move(g.name))
 {
-    DSU dsu(g);
-    node_t rootLCC = dsu.maxKey();
-    auto outOfLCC = [&dsu, &rootLCC](node_t u) { return dsu.find(u) != rootLCC; };
-    std::erase_if(g.nodes, outOfLCC);
-    std::erase_if(g.edges, [&outOfLCC](std::pair<std::pair<node_t, node_t>, weight_t> e) {
-        const auto& [u, v] = e.first;
-        return outOfLCC(u) || outOfLCC(v);
-    });
+    if (policy == ComponentPolicy::Largest) {
+        const Components comps = FindComponents(g);
+        auto outOfLCC = [&comps](node_t u) { return comps.componentOf(u) != 0; };
+        std::erase_if(g.nodes, outOfLCC);
+        std::erase_if(g.edges, [&outOfLCC](std::pair<std::pair<node_t, node_t>, weight_t> e) {
+            const auto& [u, v] = e.first;
+            return outOfLCC(u) || outOfLCC(v);
+        });
+    } else {
+        std::set<node_t> linked;
+        for (const auto& [e, w] : g.edges)
+            linked.insert(e.first), linked.insert(e.second);
+        g.nodes.swap(linked);
+    }
     n = g.nodeNum();
     m = g.edgeNum();
-    posAdjs.assign(n, {}), negAdjs.assign(n, {});
-    std::unordered_map<node_t, node_t> o2n;
-    bool renumber = *std::ranges::max_element(g.nodes) != n - 1;
+    IDMap idMap(std::vector<rawID_t>(g.nodes.begin(), g.nodes.end()), true);
+    std::vector<node_t> posDegr(n), negDegr(n);
+    for (const auto& [e, w] : g.edges) {
+        std::vector<node_t>& degr = w > 0 ? posDegr : negDegr;
+        degr[idMap[e.first]]++, degr[idMap[e.second]]++;
+    }
+    CSRFiller posFiller(posAdjs, std::move(posDegr)), negFiller(negAdjs, std::move(negDegr));
     TickSpinner spinner("SignedUndiGraph: Computing adjacency list...", m);
-    if (renumber) {
-        for (const node_t& u : g.nodes)
-            o2n[u] = o2n.size();
-        for (const auto& [e, w] : g.edges) {
-            const auto& [u, v] = e;
-            node_t newU = o2n[u], newV = o2n[v];
-            if (w > 0)
-                posAdjs[newU].push_back(newV), posAdjs[newV].push_back(newU);
-            else
-                negAdjs[newU].push_back(newV), negAdjs[newV].push_back(newU);
-            spinner.tick();
-        }
-    } else {
-        for (const auto& [e, w] : g.edges) {
-            const auto& [u, v] = e;
-            if (w > 0)
-                posAdjs[u].push_back(v), posAdjs[v].push_back(u);
-            else
-                negAdjs[u].push_back(v), negAdjs[v].push_back(u);
-            spinner.tick();
-        }
+    for (const auto& [e, w] : g.edges) {
+        const node_t newU = idMap[e.first], newV = idMap[e.second];
+        CSRFiller& filler = w > 0 ? posFiller : negFiller;
+        filler.add(newU, newV), filler.add(newV, newU);
+        spinner.tick();
     }
     spinner.markAsCompleted();
-    for (node_t u = 0; u < n; u++) {
-        std::ranges::sort(posAdjs[u]);
-        std::ranges::sort(negAdjs[u]);
-    }
+    originalIDs = std::move(idMap.ids);
     std::set<node_t> nodes;
     std::map<std::pair<node_t, node_t>, weight_t> edges;
     nodes.swap(g.nodes);
     edges.swap(g.edges);
 }
-SignedUndiGraph::SignedUndiGraph(std::string&& name, std::istream& in)
-    : SignedUndiGraph(WeightedUndiGraph(std::move(name), in))
+SignedUndiGraph::SignedUndiGraph(std::string&& name, std::vector<std::tuple<rawID_t, rawID_t, weight_t>>&& rawEdges, ComponentPolicy policy)
+    : name(name)
+{
+    EdgeBuffer<true> edges;
+    originalIDs = CompactLCC<true>(rawEdges, edges, policy);
+    n = originalIDs.size();
+    m = edges.size();
+    std::vector<node_t> posDegr(n), negDegr(n);
+    for (const auto& [u, v, w] : edges) {
+        std::vector<node_t>& degr = w > 0 ? posDegr : negDegr;
+        degr[u]++, degr[v]++;
+    }
+    CSRFiller posFiller(posAdjs, std::move(posDegr)), negFiller(negAdjs, std::move(negDegr));
+    TickSpinner spinner("SignedUndiGraph: Computing adjacency list...", m);
+    for (const auto& [u, v, w] : edges) {
+        CSRFiller& filler = w > 0 ? posFiller : negFiller;
+        filler.add(u, v), filler.add(v, u);
+        spinner.tick();
+    }
+    spinner.markAsCompleted();
+}
+SignedUndiGraph::SignedUndiGraph(std::string&& name, std::istream& in, ComponentPolicy policy)
+    : SignedUndiGraph(std::move(name), ReadEdgeBuffer<true>(in, std::format("Reading SignedUndiGraph {}", name)), policy)
+{
+}
+SignedUndiGraph::SignedUndiGraph(std::string&& name, const std::filesystem::path& source, ComponentPolicy policy)
+    : SignedUndiGraph(std::move(name), ReadEdgeBuffer<true>(source, std::format("Reading SignedUndiGraph {}", name)), policy)
 {
 }
-SignedUndiGraph::SignedUndiGraph(std::string&& name, const std::filesystem::path& source)
-    : SignedUndiGraph(WeightedUndiGraph(std::move(name), source))
+SignedUndiGraph::SignedUndiGraph(std::string&& name, EdgeStream& in, ComponentPolicy policy)
+    : SignedUndiGraph(std::move(name), ReadEdgeBuffer<true>(in, std::format("Reading SignedUndiGraph {}", name)), policy)
 {
 }
 }
\ No newline at end of file
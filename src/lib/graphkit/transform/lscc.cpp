@@ -1,111 +1,49 @@
 #include "graphkit.h"
+#include "graphkitcompact.h"
 #include "graphkitutils.h"
 #include <algorithm>
+#include <format>
 #include <iterator>
-#include <unordered_map>
-#include <unordered_set>
+#include <set>
+#include <tuple>
 #include <utility>
 #include <vector>
 
-using gkit::node_t, gkit::weight_t;
+using gkit::node_t, gkit::rawID_t, gkit::weight_t;
 
-struct TarjanImpl {
-    std::unordered_map<node_t, node_t> dfn, low, sccID;
-    std::unordered_set<node_t> inStk, outOfDfsStk, vis;
-    std::vector<std::pair<node_t, node_t>> dfsStk;
-    std::vector<node_t> stk, sccSizes { 0 };
-    node_t dfnCnt = 0ull, sccCnt = 0ull;
-    void addToStk(const node_t u)
-    {
-        vis.insert(u);
-        dfn[u] = low[u] = ++dfnCnt;
-        stk.push_back(u);
-        inStk.insert(u);
-    }
-    void checkLSCC(node_t pre, node_t u)
-    {
-        dfsStk.pop_back();
-        if (outOfDfsStk.contains(u))
-            return;
-        outOfDfsStk.insert(u);
-        if (pre)
-            low[pre] = std::min(low[pre], low[u]);
-        if (dfn[u] == low[u]) {
-            sccCnt++;
-            node_t sccSize = 0, v;
-            do {
-                v = stk.back();
-                stk.pop_back(), inStk.erase(v);
-                sccID[v] = sccCnt;
-                sccSize++;
-            } while (v != u);
-            sccSizes.push_back(sccSize);
-        }
-    }
-    TarjanImpl(gkit::UnweightedDiGraph& g)
+// Reduces raw to its LSCC, moved into edges with nodes numbered 0..n-1, and returns the original IDs
+// of the n nodes. Every node is kept under the other policies.
+template <bool Weighted>
+std::vector<rawID_t> CompactLSCC(gkit::RawEdgeBuffer<Weighted>& raw, gkit::EdgeBuffer<Weighted>& edges, gkit::ComponentPolicy policy)
+{
+    gkit::CanonicalizeEdges<Weighted>(raw, true);
+    std::vector<rawID_t> ids = gkit::DensifyEdges<Weighted>(raw, edges);
+    if (policy != gkit::ComponentPolicy::Largest)
+        return ids;
+    std::vector<bool> inLSCC;
     {
-        TickSpinner spinner("LSCC: Performing Tarjan algorithm...", g.nodeNum());
-        for (const auto& p : g.adjs) {
-            const node_t i = p.first;
-            if (vis.contains(i))
-                continue;
-            dfsStk.push_back({ 0, i });
-            while (!dfsStk.empty()) {
-                const auto [pre, u] = dfsStk.back();
-                if (!vis.contains(u)) {
-                    addToStk(u);
-                    spinner.tick();
-                    for (const node_t& v : g.adjs[u]) {
-                        if (!vis.contains(v))
-                            dfsStk.push_back({ u, v });
-                        else if (inStk.contains(v))
-                            low[u] = std::min(low[u], dfn[v]);
-                    }
-                } else
-                    checkLSCC(pre, u);
-            }
-        }
-        spinner.markAsCompleted();
+        std::vector<node_t> degr(ids.size());
+        for (const gkit::EdgeTuple<Weighted>& e : edges)
+            degr[std::get<0>(e)]++;
+        gkit::CSR adjs;
+        gkit::CSRFiller filler(adjs, std::move(degr));
+        for (const gkit::EdgeTuple<Weighted>& e : edges)
+            filler.add(std::get<0>(e), std::get<1>(e));
+        inLSCC = gkit::LargestLabel(gkit::LabelSCC(adjs));
     }
-    TarjanImpl(gkit::WeightedDiGraph& g)
-    {
-        TickSpinner spinner("LSCC: Performing Tarjan algorithm...", g.nodeNum());
-        for (const auto& p : g.adjs) {
-            const node_t i = p.first;
-            if (vis.contains(i))
-                continue;
-            dfsStk.push_back({ 0, i });
-            while (!dfsStk.empty()) {
-                const auto [pre, u] = dfsStk.back();
-                if (!vis.contains(u)) {
-                    addToStk(u);
-                    spinner.tick();
-                    for (const auto& p : g.adjs[u]) {
-                        node_t v = p.first;
-                        if (!vis.contains(v))
-                            dfsStk.push_back({ u, v });
-                        else if (inStk.contains(v))
-                            low[u] = std::min(low[u], dfn[v]);
-                    }
-                } else
-                    checkLSCC(pre, u);
-            }
-        }
-        spinner.markAsCompleted();
-    }
-    node_t maxKey() { return std::distance(sccSizes.begin(), std::ranges::max_element(sccSizes)); }
-};
+    gkit::FilterEdges<Weighted>(edges, inLSCC, ids);
+    return ids;
+}
 
 namespace gkit {
 UnweightedDiGraph UnweightedDiGraph::LSCC()
 {
-    TarjanImpl tarjanImpl(*this);
-    node_t rootLSCC = tarjanImpl.maxKey();
+    const Components comps = FindComponents(*this);
     std::string newName(name);
     newName.append("_LSCC");
     std::map<node_t, std::vector<node_t>> newAdjs;
     std::set<std::pair<node_t, node_t>> newEdges;
-    auto inLSCC = [&tarjanImpl, &rootLSCC](node_t u) { return tarjanImpl.sccID[u] == rootLSCC; };
+    auto inLSCC = [&comps](node_t u) { return comps.componentOf(u) == 0; };
     TickSpinner spinner("LSCC: Constructing ans graph...", nodeNum());
     for (const auto& [u, adj] : adjs) {
         spinner.tick();
@@ -120,13 +58,12 @@ UnweightedDiGraph UnweightedDiGraph::LSCC()
 }
 WeightedDiGraph WeightedDiGraph::LSCC()
 {
-    TarjanImpl tarjanImpl(*this);
-    node_t rootLSCC = tarjanImpl.maxKey();
+    const Components comps = FindComponents(*this);
     std::string newName(name);
     newName.append("_LSCC");
     std::map<node_t, std::vector<std::pair<node_t, weight_t>>> newAdjs;
     std::map<std::pair<node_t, node_t>, weight_t> newEdges;
-    auto inLSCC = [&tarjanImpl, &rootLSCC](node_t u) { return tarjanImpl.sccID[u] == rootLSCC; };
+    auto inLSCC = [&comps](node_t u) { return comps.componentOf(u) == 0; };
     TickSpinner spinner("LSCC: Constructing ans graph...", nodeNum());
     for (const auto& [u, adj] : adjs) {
         spinner.tick();
@@ -143,122 +80,159 @@ WeightedDiGraph WeightedDiGraph::LSCC()
     return WeightedDiGraph(std::move(newName), std::move(newAdjs), std::move(newEdges));
 }
 
-SimpleDiGraph::SimpleDiGraph(UnweightedDiGraph&& g)
+SimpleDiGraph::SimpleDiGraph(UnweightedDiGraph&& g, ComponentPolicy policy)
     : name(std::move(g.name))
 {
-    TarjanImpl tarjanImpl(g);
-    node_t rootLSCC = tarjanImpl.maxKey();
-    auto outOfLSCC = [&tarjanImpl, &rootLSCC](node_t u) { return tarjanImpl.sccID[u] != rootLSCC; };
-    std::erase_if(g.adjs, [&outOfLSCC](std::pair<node_t, std::vector<node_t>> p) { return outOfLSCC(p.first); });
+    const bool keepLargest = policy == ComponentPolicy::Largest;
+    const Components comps = keepLargest ? FindComponents(g) : Components();
+    auto outOfLSCC = [&comps](node_t u) { return comps.componentOf(u) != 0; };
+    if (keepLargest)
+        std::erase_if(g.adjs, [&outOfLSCC](std::pair<node_t, std::vector<node_t>> p) { return outOfLSCC(p.first); });
+    else {
+        // Full keeps the nodes with an edge; isolated ones can only come from addNode.
+        std::set<node_t> targets;
+        for (const auto& [u, v] : g.edges)
+            targets.insert(v);
+        std::erase_if(g.adjs, [&targets](const std::pair<const node_t, std::vector<node_t>>& p) { return p.second.empty() && !targets.contains(p.first); });
+    }
     n = g.nodeNum();
     m = 0ull;
-    node_t max_node = 0ull;
-    TickSpinner spinner1("SimpleDiGraph: Removing nodes out of LSCC...", n);
+    std::vector<rawID_t> ids;
+    std::vector<node_t> degr;
+    ids.reserve(n), degr.reserve(n);
+    TickSpinner spinner1(keepLargest ? "SimpleDiGraph: Removing nodes out of LSCC..." : "SimpleDiGraph: Counting degrees...", n);
     for (auto& [u, adj] : g.adjs) {
-        max_node = std::max(max_node, u);
-        std::erase_if(adj, outOfLSCC);
+        if (keepLargest)
+            std::erase_if(adj, outOfLSCC);
+        ids.push_back(u), degr.push_back(adj.size());
         m += adj.size();
         spinner1.tick();
     }
     spinner1.markAsCompleted();
-    std::unordered_map<node_t, node_t> o2n;
-    adjs.assign(n, {});
-    bool renumber = max_node != n - 1;
+    IDMap idMap(std::move(ids), true);
+    CSRFiller filler(adjs, std::move(degr));
     TickSpinner spinner2("SimpleDiGraph: Computing adjacency list...", n);
-    if (renumber) {
-        for (const auto& [u, _] : g.adjs)
-            o2n[u] = o2n.size();
-        for (auto& [u, adj] : g.adjs) {
-            node_t newU = o2n[u];
-            std::ranges::transform(adj, adj.begin(), [&o2n](node_t u) { return o2n[u]; });
-            std::ranges::sort(adj);
-            adjs[newU].swap(adj);
-            spinner2.tick();
-        }
-    } else {
-        for (auto& [u, adj] : g.adjs) {
-            adjs[u].swap(adj);
-            spinner2.tick();
-        }
+    node_t newU = 0;
+    for (const auto& [u, adj] : g.adjs) {
+        for (const node_t& v : adj)
+            filler.add(newU, idMap[v]);
+        std::ranges::sort(adjs[newU++]);
+        spinner2.tick();
     }
     spinner2.markAsCompleted();
+    originalIDs = std::move(idMap.ids);
     std::map<node_t, std::vector<node_t>> nullAdjs;
     std::set<std::pair<node_t, node_t>> edges;
     nullAdjs.swap(g.adjs);
     edges.swap(g.edges);
 }
-SimpleDiGraph::SimpleDiGraph(std::string&& name, std::istream& in)
-    : SimpleDiGraph(UnweightedDiGraph(std::move(name), in))
+SimpleDiGraph::SimpleDiGraph(std::string&& name, std::vector<std::pair<rawID_t, rawID_t>>&& rawEdges, ComponentPolicy policy)
+    : name(name)
+{
+    EdgeBuffer<false> edges;
+    originalIDs = CompactLSCC<false>(rawEdges, edges, policy);
+    n = originalIDs.size();
+    m = edges.size();
+    std::vector<node_t> degr(n);
+    for (const auto& [u, v] : edges)
+        degr[u]++;
+    CSRFiller filler(adjs, std::move(degr));
+    TickSpinner spinner("SimpleDiGraph: Computing adjacency list...", m);
+    for (const auto& [u, v] : edges) {
+        filler.add(u, v);
+        spinner.tick();
+    }
+    spinner.markAsCompleted();
+}
+SimpleDiGraph::SimpleDiGraph(std::string&& name, std::istream& in, ComponentPolicy policy)
+    : SimpleDiGraph(std::move(name), ReadEdgeBuffer<false>(in, std::format("Reading SimpleDiGraph {}", name)), policy)
 {
 }
-SimpleDiGraph::SimpleDiGraph(std::string&& name, const std::filesystem::path& source)
-    : SimpleDiGraph(UnweightedDiGraph(std::move(name), source))
+SimpleDiGraph::SimpleDiGraph(std::string&& name, const std::filesystem::path& source, ComponentPolicy policy)
+    : SimpleDiGraph(std::move(name), ReadEdgeBuffer<false>(source, std::format("Reading SimpleDiGraph {}", name)), policy)
+{
+}
+SimpleDiGraph::SimpleDiGraph(std::string&& name, EdgeStream& in, ComponentPolicy policy)
+    : SimpleDiGraph(std::move(name), ReadEdgeBuffer<false>(in, std::format("Reading SimpleDiGraph {}", name)), policy)
 {
 }
 
-SignedDiGraph::SignedDiGraph(WeightedDiGraph&& g)
+SignedDiGraph::SignedDiGraph(WeightedDiGraph&& g, ComponentPolicy policy)
     : name(std::move(g.name))
 {
-    TarjanImpl tarjanImpl(g);
-    node_t rootLSCC = tarjanImpl.maxKey();
-    auto outOfLSCC = [&tarjanImpl, &rootLSCC](node_t u) { return tarjanImpl.sccID[u] != rootLSCC; };
-    std::erase_if(g.adjs, [&outOfLSCC](std::pair<node_t, std::vector<std::pair<node_t, weight_t>>> p) { return outOfLSCC(p.first); });
+    const bool keepLargest = policy == ComponentPolicy::Largest;
+    const Components comps = keepLargest ? FindComponents(g) : Components();
+    auto outOfLSCC = [&comps](node_t u) { return comps.componentOf(u) != 0; };
+    if (keepLargest)
+        std::erase_if(g.adjs, [&outOfLSCC](std::pair<node_t, std::vector<std::pair<node_t, weight_t>>> p) { return outOfLSCC(p.first); });
+    else {
+        std::set<node_t> targets;
+        for (const auto& [e, w] : g.edges)
+            targets.insert(e.second);
+        std::erase_if(g.adjs, [&targets](const std::pair<const node_t, std::vector<std::pair<node_t, weight_t>>>& p) { return p.second.empty() && !targets.contains(p.first); });
+    }
     n = g.nodeNum();
     m = 0ull;
-    node_t max_node = 0ull;
-    TickSpinner spinner1("SignedDiGraph: Removing nodes out of LSCC...", n);
+    std::vector<rawID_t> ids;
+    std::vector<node_t> posDegr, negDegr;
+    ids.reserve(n), posDegr.reserve(n), negDegr.reserve(n);
+    TickSpinner spinner1(keepLargest ? "SignedDiGraph: Removing nodes out of LSCC..." : "SignedDiGraph: Counting degrees...", n);
     for (auto& [u, adj] : g.adjs) {
-        max_node = std::max(max_node, u);
-        std::erase_if(adj, [&outOfLSCC](std::pair<node_t, weight_t> p) { return outOfLSCC(p.first); });
+        if (keepLargest)
+            std::erase_if(adj, [&outOfLSCC](std::pair<node_t, weight_t> p) { return outOfLSCC(p.first); });
+        const node_t posNum = std::ranges::count_if(adj, [](std::pair<node_t, weight_t> p) { return p.second > 0; });
+        ids.push_back(u), posDegr.push_back(posNum), negDegr.push_back(adj.size() - posNum);
         m += adj.size();
         spinner1.tick();
     }
     spinner1.markAsCompleted();
-    std::unordered_map<node_t, node_t> o2n;
-    posAdjs.assign(n, {}), negAdjs.assign(n, {});
-    bool renumber = max_node != n - 1;
+    IDMap idMap(std::move(ids), true);
+    CSRFiller posFiller(posAdjs, std::move(posDegr)), negFiller(negAdjs, std::move(negDegr));
     TickSpinner spinner2("SignedDiGraph: Computing adjacency list...", m);
-    if (renumber) {
-        for (const auto& [u, _] : g.adjs)
-            o2n[u] = o2n.size();
-        for (const auto& [u, adj] : g.adjs) {
-            node_t newU = o2n[u];
-            for (const auto& [v, w] : adj) {
-                node_t newV = o2n[v];
-                if (w > 0)
-                    posAdjs[newU].push_back(newV);
-                else
-                    negAdjs[newU].push_back(newV);
-                spinner2.tick();
-            }
-            std::ranges::sort(posAdjs[newU]);
-            std::ranges::sort(negAdjs[newU]);
-        }
-    } else {
-        for (const auto& [u, adj] : g.adjs) {
-            for (const auto& [v, w] : adj) {
-                if (w > 0)
-                    posAdjs[u].push_back(v);
-                else
-                    negAdjs[u].push_back(v);
-                spinner2.tick();
-            }
-            std::ranges::sort(posAdjs[u]);
-            std::ranges::sort(negAdjs[u]);
+    node_t newU = 0;
+    for (const auto& [u, adj] : g.adjs) {
+        for (const auto& [v, w] : adj) {
+            (w > 0 ? posFiller : negFiller).add(newU, idMap[v]);
+            spinner2.tick();
         }
+        std::ranges::sort(posAdjs[newU]);
+        std::ranges::sort(negAdjs[newU++]);
     }
     spinner2.markAsCompleted();
+    originalIDs = std::move(idMap.ids);
     std::map<node_t, std::vector<std::pair<node_t, weight_t>>> adjs;
     std::map<std::pair<node_t, node_t>, weight_t> edges;
     adjs.swap(g.adjs);
     edges.swap(g.edges);
 }
-SignedDiGraph::SignedDiGraph(std::string&& name, std::istream& in)
-    : SignedDiGraph(WeightedDiGraph(std::move(name), in))
+SignedDiGraph::SignedDiGraph(std::string&& name, std::vector<std::tuple<rawID_t, rawID_t, weight_t>>&& rawEdges, ComponentPolicy policy)
+    : name(name)
+{
+    EdgeBuffer<true> edges;
+    originalIDs = CompactLSCC<true>(rawEdges, edges, policy);
+    n = originalIDs.size();
+    m = edges.size();
+    std::vector<node_t> posDegr(n), negDegr(n);
+    for (const auto& [u, v, w] : edges)
+        (w > 0 ? posDegr : negDegr)[u]++;
+    CSRFiller posFiller(posAdjs, std::move(posDegr)), negFiller(negAdjs, std::move(negDegr));
+    TickSpinner spinner("SignedDiGraph: Computing adjacency list...", m);
+    for (const auto& [u, v, w] : edges) {
+        (w > 0 ? posFiller : negFiller).add(u, v);
+        spinner.tick();
+    }
+    spinner.markAsCompleted();
+}
+SignedDiGraph::SignedDiGraph(std::string&& name, std::istream& in, ComponentPolicy policy)
+    : SignedDiGraph(std::move(name), ReadEdgeBuffer<true>(in, std::format("Reading SignedDiGraph {}", name)), policy)
+{
+}
+SignedDiGraph::SignedDiGraph(std::string&& name, const std::filesystem::path& source, ComponentPolicy policy)
+    : SignedDiGraph(std::move(name), ReadEdgeBuffer<true>(source, std::format("Reading SignedDiGraph {}", name)), policy)
 {
 }
-SignedDiGraph::SignedDiGraph(std::string&& name, const std::filesystem::path& source)
-    : SignedDiGraph(WeightedDiGraph(std::move(name), source))
+SignedDiGraph::SignedDiGraph(std::string&& name, EdgeStream& in, ComponentPolicy policy)
+    : SignedDiGraph(std::move(name), ReadEdgeBuffer<true>(in, std::format("Reading SignedDiGraph {}", name)), policy)
 {
 }
 }
@@ -0,0 +1,90 @@
+#include "graphkitcompact.h"
+#include "graphkitutils.h"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace {
+constexpr unsigned radixBits = 8;
+constexpr std::uint64_t radixSize = 1 << radixBits;
+constexpr std::uint64_t radixBlockSize = 1 << 16;
+}
+
+namespace gkit {
+// One pass per byte up to the highest set bit of the largest key. Keys are cut into fixed blocks
+// and every block scatters into ranges given by its own digit counts, so each pass is stable
+// whatever the thread scheduling.
+void RadixSort(std::vector<rawID_t>& keys)
+{
+    const std::uint64_t size = keys.size();
+    if (size <= radixBlockSize) {
+        std::ranges::sort(keys);
+        return;
+    }
+    const unsigned threadNum = GetThreadNum();
+    const std::uint64_t blockNum = (size + radixBlockSize - 1) / radixBlockSize;
+    auto blockEnd = [size](std::uint64_t b) { return std::min((b + 1) * radixBlockSize, size); };
+    std::vector<rawID_t> blockMax(blockNum);
+    ParallelFor(threadNum, 0, blockNum, 1, [&](std::uint64_t b) {
+        blockMax[b] = *std::max_element(keys.begin() + b * radixBlockSize, keys.begin() + blockEnd(b));
+    });
+    const std::uint64_t maxKey = *std::ranges::max_element(blockMax);
+    std::vector<rawID_t> buffer(size);
+    std::vector<std::uint64_t> count(blockNum * radixSize);
+    for (unsigned shift = 0; shift < 64 && (maxKey >> shift) != 0; shift += radixBits) {
+        auto digit = [shift](rawID_t key) { return (key >> shift) & (radixSize - 1); };
+        std::ranges::fill(count, 0);
+        ParallelFor(threadNum, 0, blockNum, 1, [&](std::uint64_t b) {
+            std::uint64_t* blockCount = count.data() + b * radixSize;
+            for (std::uint64_t i = b * radixBlockSize; i < blockEnd(b); i++)
+                blockCount[digit(keys[i])]++;
+        });
+        // Digit-major prefix sums: block b writes digit d after all smaller digits and after the earlier blocks.
+        std::uint64_t total = 0;
+        for (std::uint64_t d = 0; d < radixSize; d++) {
+            for (std::uint64_t b = 0; b < blockNum; b++) {
+                const std::uint64_t c = count[b * radixSize + d];
+                count[b * radixSize + d] = total;
+                total += c;
+            }
+        }
+        ParallelFor(threadNum, 0, blockNum, 1, [&](std::uint64_t b) {
+            std::uint64_t* blockPos = count.data() + b * radixSize;
+            for (std::uint64_t i = b * radixBlockSize; i < blockEnd(b); i++)
+                buffer[blockPos[digit(keys[i])]++] = keys[i];
+        });
+        keys.swap(buffer);
+    }
+}
+
+IDMap::IDMap(std::vector<rawID_t>&& nodeIDs, bool sorted)
+    : ids(std::move(nodeIDs))
+{
+    if (!sorted) {
+        RadixSort(ids);
+        ids.erase(std::ranges::unique(ids).begin(), ids.end());
+        ids.shrink_to_fit();
+    }
+    CheckIndexRange<node_t>(ids.size(), "Node count");
+    if (ids.empty())
+        return;
+    const std::uint64_t spread = ids.back() - ids.front();
+    if (spread < lookupSpread * ids.size()) {
+        lookup.resize(spread + 1);
+        ParallelFor(GetThreadNum(), 0, ids.size(), radixBlockSize, [this](std::uint64_t i) { lookup[ids[i] - ids.front()] = i; });
+        return;
+    }
+    while ((spread >> bucketShift) >= ids.size())
+        bucketShift++;
+    auto bucket = [this](rawID_t u) { return (u - ids.front()) >> bucketShift; };
+    const std::uint64_t bucketNum = bucket(ids.back()) + 1;
+    buckets.resize(bucketNum + 1);
+    // Node i starts every bucket after the one of node i - 1, up to its own.
+    ParallelFor(GetThreadNum(), 0, ids.size(), radixBlockSize, [&](std::uint64_t i) {
+        for (std::uint64_t b = i == 0 ? 0 : bucket(ids[i - 1]) + 1; b <= bucket(ids[i]); b++)
+            buckets[b] = i;
+    });
+    buckets[bucketNum] = ids.size();
+}
+}
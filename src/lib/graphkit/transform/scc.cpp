@@ -0,0 +1,241 @@
+#include "graphkit.h"
+#include "graphkitcompact.h"
+#include "graphkitutils.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using gkit::node_t, gkit::CSR;
+using std::uint64_t;
+
+namespace {
+constexpr node_t noSCC = std::numeric_limits<node_t>::max();
+constexpr uint64_t sccBlockSize = 1 << 12;
+// Below this many unlabeled nodes the parallel engine hands the rest to Tarjan.
+constexpr node_t serialNodeNum = 1 << 14;
+// Colour propagation needs as many rounds as the longest path it has to cover, so it is given
+// up for Tarjan on chain-like remainders.
+constexpr unsigned maxColoringRounds = 64;
+
+// Iterative Tarjan on the nodes with label[u] == noSCC; each SCC is labeled with its DFS root.
+// Labeled nodes already belong to finished SCCs, so edges into them are ignored.
+void TarjanLabels(const CSR& adjs, std::vector<node_t>& label, TickSpinner& spinner)
+{
+    const node_t n = adjs.size();
+    std::vector<node_t> dfn(n), low(n), stk;
+    std::vector<std::pair<node_t, gkit::offset_t>> dfsStk;
+    node_t dfnCnt = 0;
+    for (node_t i = 0; i < n; i++) {
+        if (label[i] != noSCC || dfn[i])
+            continue;
+        dfn[i] = low[i] = ++dfnCnt;
+        stk.push_back(i), dfsStk.push_back({ i, adjs.offsets[i] });
+        while (!dfsStk.empty()) {
+            auto& [u, pos] = dfsStk.back();
+            if (pos < adjs.offsets[u + 1]) {
+                const node_t v = adjs.targets[pos++];
+                if (label[v] != noSCC)
+                    continue;
+                if (!dfn[v]) {
+                    dfn[v] = low[v] = ++dfnCnt;
+                    stk.push_back(v), dfsStk.push_back({ v, adjs.offsets[v] });
+                } else
+                    low[u] = std::min(low[u], dfn[v]);
+                continue;
+            }
+            const node_t w = u;
+            dfsStk.pop_back();
+            if (!dfsStk.empty())
+                low[dfsStk.back().first] = std::min(low[dfsStk.back().first], low[w]);
+            if (dfn[w] == low[w]) {
+                node_t v;
+                do {
+                    v = stk.back();
+                    stk.pop_back();
+                    label[v] = w;
+                    spinner.tick();
+                } while (v != w);
+            }
+        }
+    }
+}
+
+// Trimming, forward-backward search and coloring on GetThreadNum() threads (Multistep SCC).
+// The SCCs found do not depend on the thread count.
+struct ParallelSCC {
+    const CSR &adjs, invAdjs;
+    std::vector<node_t>& label;
+    TickSpinner& spinner;
+    unsigned threadNum;
+    std::vector<node_t> active;
+    ParallelSCC(const CSR& adjs, const CSR& invAdjs, std::vector<node_t>& label, TickSpinner& spinner)
+        : adjs(adjs)
+        , invAdjs(invAdjs)
+        , label(label)
+        , spinner(spinner)
+        , threadNum(gkit::GetThreadNum())
+    {
+        active.resize(adjs.size());
+        for (node_t u = 0; u < adjs.size(); u++)
+            active[u] = u;
+    }
+    bool hasActiveNeighbor(const CSR& csr, node_t u) const
+    {
+        return std::ranges::any_of(csr[u], [this, u](node_t v) { return v != u && label[v] == noSCC; });
+    }
+    void dropLabeled()
+    {
+        const uint64_t before = active.size();
+        std::erase_if(active, [this](node_t u) { return label[u] != noSCC; });
+        spinner.tick(before - active.size());
+    }
+    // Nodes without an unlabeled in- or out-neighbour are SCCs of their own. Rounds stop
+    // once they remove less than 1/64 of the remaining nodes.
+    void trim()
+    {
+        while (!active.empty()) {
+            std::vector<std::uint8_t> trimmed(active.size());
+            ParallelFor(threadNum, 0, active.size(), sccBlockSize, [&](uint64_t i) {
+                trimmed[i] = !hasActiveNeighbor(adjs, active[i]) || !hasActiveNeighbor(invAdjs, active[i]);
+            });
+            uint64_t trimmedNum = 0;
+            for (uint64_t i = 0; i < active.size(); i++)
+                if (trimmed[i])
+                    label[active[i]] = active[i], trimmedNum++;
+            dropLabeled();
+            if (trimmedNum * 64 < active.size() + trimmedNum)
+                break;
+        }
+    }
+    // Level-synchronous search from source over unlabeled nodes; sets mark[u] for every reached node.
+    void reach(const CSR& csr, node_t source, std::atomic<std::uint8_t>* mark) const
+    {
+        std::vector<node_t> frontier { source };
+        mark[source].store(1, std::memory_order_relaxed);
+        while (!frontier.empty()) {
+            const uint64_t blockNum = (frontier.size() + sccBlockSize - 1) / sccBlockSize;
+            std::vector<std::vector<node_t>> next(blockNum);
+            ParallelFor(threadNum, 0, blockNum, 1, [&](uint64_t b) {
+                const uint64_t hi = std::min<uint64_t>((b + 1) * sccBlockSize, frontier.size());
+                for (uint64_t i = b * sccBlockSize; i < hi; i++)
+                    for (const node_t& v : csr[frontier[i]])
+                        if (label[v] == noSCC && !mark[v].load(std::memory_order_relaxed) && !mark[v].exchange(1, std::memory_order_relaxed))
+                            next[b].push_back(v);
+            });
+            frontier.clear();
+            for (const std::vector<node_t>& block : next)
+                frontier.insert(frontier.end(), block.begin(), block.end());
+        }
+    }
+    // The SCC of the node with the largest in-degree times out-degree is usually the giant one:
+    // it is the intersection of the nodes reachable from the pivot and the nodes reaching it.
+    void forwardBackward()
+    {
+        node_t pivot = active.front();
+        for (const node_t& u : active)
+            if (std::uint64_t(adjs.degree(u)) * invAdjs.degree(u) > std::uint64_t(adjs.degree(pivot)) * invAdjs.degree(pivot))
+                pivot = u;
+        const node_t n = adjs.size();
+        std::unique_ptr<std::atomic<std::uint8_t>[]> fw(new std::atomic<std::uint8_t>[n]), bw(new std::atomic<std::uint8_t>[n]);
+        ParallelFor(threadNum, 0, n, sccBlockSize << 4, [&](uint64_t u) {
+            fw[u].store(0, std::memory_order_relaxed), bw[u].store(0, std::memory_order_relaxed);
+        });
+        reach(adjs, pivot, fw.get());
+        reach(invAdjs, pivot, bw.get());
+        ParallelFor(threadNum, 0, active.size(), sccBlockSize, [&](uint64_t i) {
+            const node_t u = active[i];
+            if (fw[u].load(std::memory_order_relaxed) && bw[u].load(std::memory_order_relaxed))
+                label[u] = pivot;
+        });
+        dropLabeled();
+    }
+    // Every node takes the largest ID that reaches it; each node keeping its own ID is then
+    // the root of an SCC made of the nodes of its colour that reach it. Returns false without
+    // labeling anything if the colours do not settle within maxColoringRounds.
+    bool coloring()
+    {
+        const node_t n = adjs.size();
+        std::unique_ptr<std::atomic<node_t>[]> color(new std::atomic<node_t>[n]);
+        ParallelFor(threadNum, 0, active.size(), sccBlockSize, [&](uint64_t i) { color[active[i]].store(active[i], std::memory_order_relaxed); });
+        unsigned round = 0;
+        for (std::atomic<bool> changed(true); changed.exchange(false); round++) {
+            if (round == maxColoringRounds)
+                return false;
+            ParallelFor(threadNum, 0, active.size(), sccBlockSize, [&](uint64_t i) {
+                const node_t u = active[i];
+                const node_t c = color[u].load(std::memory_order_relaxed);
+                for (const node_t& v : adjs[u]) {
+                    if (label[v] != noSCC)
+                        continue;
+                    node_t cur = color[v].load(std::memory_order_relaxed);
+                    while (cur < c && !color[v].compare_exchange_weak(cur, c, std::memory_order_relaxed))
+                        ;
+                    if (cur < c)
+                        changed.store(true, std::memory_order_relaxed);
+                }
+            });
+        }
+        std::vector<node_t> roots;
+        for (const node_t& u : active)
+            if (color[u].load(std::memory_order_relaxed) == u)
+                roots.push_back(u);
+        // Colour classes are disjoint, so every root's backward search touches its own nodes only.
+        ParallelFor(threadNum, 0, roots.size(), 1, [&](uint64_t i) {
+            const node_t r = roots[i];
+            std::vector<node_t> stk { r };
+            label[r] = r;
+            while (!stk.empty()) {
+                const node_t u = stk.back();
+                stk.pop_back();
+                for (const node_t& v : invAdjs[u]) {
+                    if (color[v].load(std::memory_order_relaxed) == r && label[v] == noSCC) {
+                        label[v] = r;
+                        stk.push_back(v);
+                    }
+                }
+            }
+        });
+        dropLabeled();
+        return true;
+    }
+    // Stops early when a round makes little progress; the caller finishes with Tarjan.
+    void run()
+    {
+        trim();
+        if (!active.empty())
+            forwardBackward();
+        while (active.size() > serialNodeNum) {
+            const uint64_t before = active.size();
+            trim();
+            if (active.empty() || !coloring() || (before - active.size()) * 64 < before)
+                break;
+        }
+    }
+};
+}
+
+namespace gkit {
+std::vector<node_t> LabelSCC(const CSR& adjs, SCCAlgorithm algorithm)
+{
+    const node_t n = adjs.size();
+    std::vector<node_t> label(n, noSCC);
+    if (algorithm == SCCAlgorithm::Auto)
+        algorithm = GetThreadNum() > 1 && n > serialNodeNum ? SCCAlgorithm::ForwardBackward : SCCAlgorithm::Tarjan;
+    if (algorithm == SCCAlgorithm::ForwardBackward) {
+        const CSR invAdjs = Transpose(adjs);
+        TickSpinner spinner("SCC: Performing forward-backward search...", n);
+        ParallelSCC(adjs, invAdjs, label, spinner).run();
+        TarjanLabels(adjs, label, spinner);
+        spinner.markAsCompleted();
+    } else {
+        TickSpinner spinner("SCC: Performing Tarjan algorithm...", n);
+        TarjanLabels(adjs, label, spinner);
+        spinner.markAsCompleted();
+    }
+    return label;
+}
+}
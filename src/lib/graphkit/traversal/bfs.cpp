@@ -0,0 +1,195 @@
+#include "graphkit.h"
+#include "graphkitcompact.h"
+#include "graphkitutils.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <vector>
+
+using gkit::node_t, gkit::CSR, gkit::BFSTree, gkit::BFSDirection;
+using std::uint64_t;
+
+namespace {
+constexpr uint64_t bfsBlockSize = 1 << 12;
+// Push until the frontier has more than 1/alpha of the unexplored edges, then pull until it
+// shrinks below 1/beta of the nodes.
+constexpr uint64_t bfsAlpha = 15;
+constexpr uint64_t bfsBeta = 18;
+
+// Neighbour access used by the engine. find() returns the first neighbour satisfying pred, or unreached.
+struct CSRNeighbors {
+    const CSR& adjs;
+    node_t degree(node_t u) const { return adjs.degree(u); }
+    template <typename F>
+    void forEach(node_t u, F&& f) const
+    {
+        for (const node_t& v : adjs[u])
+            f(v);
+    }
+    template <typename P>
+    node_t find(node_t u, P&& pred) const
+    {
+        for (const node_t& v : adjs[u])
+            if (pred(v))
+                return v;
+        return BFSTree::unreached;
+    }
+};
+struct ViewNeighbors {
+    const gkit::ExpansionView& view;
+    node_t degree(node_t u) const { return view.degree(u); }
+    template <typename F>
+    void forEach(node_t u, F&& f) const { view.forEachNeighbor(u, f); }
+    template <typename P>
+    node_t find(node_t u, P&& pred) const
+    {
+        const node_t n = view.n;
+        const bool dup = u >= n;
+        const node_t base = dup ? u - n : u;
+        for (const node_t& v : (dup ? view.negAdjs : view.posAdjs)[base])
+            if (pred(v))
+                return v;
+        for (const node_t& v : (dup ? view.posAdjs : view.negAdjs)[base])
+            if (pred(v + n))
+                return v + n;
+        return BFSTree::unreached;
+    }
+};
+
+// The frontier is a queue while pushing and a bitmap while pulling; it is converted on every switch.
+// getIn() is called on the calling thread when the first pull needs the in-neighbours. The levels run
+// on one ParallelTeam, as high-diameter graphs have many levels with little work each.
+template <typename Out, typename In, typename GetIn>
+BFSTree RunBFS(node_t n, uint64_t arcNum, const Out& out, GetIn&& getIn, node_t source, BFSDirection direction)
+{
+    if (source >= n) {
+        std::string errStr = std::format("BFS: source {} out of range [0, {})\n", source, n);
+        std::cerr << errStr;
+        std::terminate();
+    }
+    const uint64_t blockNum = (n + bfsBlockSize - 1) / bfsBlockSize;
+    BFSTree tree { source, std::vector<node_t>(n, BFSTree::unreached), std::vector<node_t>(n) };
+    std::unique_ptr<std::atomic<node_t>[]> parent(new std::atomic<node_t>[n]);
+    tree.dist[source] = 0;
+    std::optional<In> in;
+    std::vector<node_t> queue { source };
+    std::vector<std::uint8_t> front, next;
+    std::vector<std::vector<node_t>> nextQueue;
+    std::vector<uint64_t> blockNodes, blockArcs;
+    bool pulling = false;
+    uint64_t prevFrontierNodes = 0, frontierNodes = 1, frontierArcs = out.degree(source), uncheckedArcs = arcNum - frontierArcs;
+    uint64_t queueBlockNum = 0;
+    ParallelTeam team(std::min<uint64_t>(gkit::GetThreadNum(), blockNum));
+    // Shared state is only written in serial steps, between the barriers of the passes that read it.
+    team.run([&](unsigned t) {
+        team.forEach(0, n, bfsBlockSize, [&](uint64_t u) { parent[u].store(u == source ? source : BFSTree::unreached, std::memory_order_relaxed); });
+        for (node_t level = 0; frontierNodes > 0; level++) {
+            team.serial(t, [&]() {
+                bool pull = direction == BFSDirection::BottomUp;
+                if (direction == BFSDirection::Auto)
+                    pull = pulling ? frontierNodes >= prevFrontierNodes || frontierNodes * bfsBeta > n : frontierArcs * bfsAlpha > uncheckedArcs;
+                if (pull && !in)
+                    in.emplace(getIn());
+                if (pull && !pulling) {
+                    front.assign(n, 0);
+                    for (const node_t& u : queue)
+                        front[u] = 1;
+                    next.resize(n);
+                } else if (!pull && pulling) {
+                    queue.clear();
+                    for (node_t u = 0; u < n; u++)
+                        if (front[u])
+                            queue.push_back(u);
+                }
+                pulling = pull;
+                if (pulling) {
+                    blockNodes.assign(blockNum, 0), blockArcs.assign(blockNum, 0);
+                } else {
+                    queueBlockNum = (queue.size() + bfsBlockSize - 1) / bfsBlockSize;
+                    nextQueue.assign(queueBlockNum, {}), blockArcs.assign(queueBlockNum, 0);
+                }
+            });
+            const node_t nextDist = level + 1;
+            if (pulling) {
+                team.forEach(0, blockNum, 1, [&](uint64_t b) {
+                    const uint64_t hi = std::min<uint64_t>((b + 1) * bfsBlockSize, n);
+                    for (uint64_t v = b * bfsBlockSize; v < hi; v++) {
+                        next[v] = 0;
+                        if (parent[v].load(std::memory_order_relaxed) != BFSTree::unreached)
+                            continue;
+                        const node_t u = in->find(v, [&front](node_t w) { return front[w] != 0; });
+                        if (u == BFSTree::unreached)
+                            continue;
+                        parent[v].store(u, std::memory_order_relaxed);
+                        tree.dist[v] = nextDist, next[v] = 1;
+                        blockNodes[b]++, blockArcs[b] += out.degree(v);
+                    }
+                });
+            } else {
+                team.forEach(0, queueBlockNum, 1, [&](uint64_t b) {
+                    const uint64_t hi = std::min<uint64_t>((b + 1) * bfsBlockSize, queue.size());
+                    for (uint64_t i = b * bfsBlockSize; i < hi; i++)
+                        out.forEach(queue[i], [&](node_t v) {
+                            node_t expected = BFSTree::unreached;
+                            if (parent[v].load(std::memory_order_relaxed) == BFSTree::unreached && parent[v].compare_exchange_strong(expected, queue[i], std::memory_order_relaxed)) {
+                                tree.dist[v] = nextDist;
+                                nextQueue[b].push_back(v);
+                                blockArcs[b] += out.degree(v);
+                            }
+                        });
+                });
+            }
+            team.serial(t, [&]() {
+                if (pulling) {
+                    front.swap(next);
+                } else {
+                    queue.clear();
+                    for (const std::vector<node_t>& block : nextQueue)
+                        queue.insert(queue.end(), block.begin(), block.end());
+                    blockNodes.assign(1, queue.size());
+                }
+                prevFrontierNodes = frontierNodes;
+                frontierNodes = std::reduce(blockNodes.begin(), blockNodes.end(), uint64_t(0));
+                frontierArcs = std::reduce(blockArcs.begin(), blockArcs.end(), uint64_t(0));
+                uncheckedArcs -= frontierArcs;
+            });
+        }
+        team.forEach(0, n, bfsBlockSize, [&](uint64_t u) { tree.parent[u] = parent[u].load(std::memory_order_relaxed); });
+    });
+    return tree;
+}
+}
+
+namespace gkit {
+BFSTree BFS(const SimpleUndiGraph& g, node_t source, BFSDirection direction)
+{
+    const CSRNeighbors adjs { g.adjs };
+    return RunBFS<CSRNeighbors, CSRNeighbors>(g.n, g.adjs.targets.size(), adjs, [&adjs]() { return adjs; }, source, direction);
+}
+BFSTree BFS(const SimpleDiGraph& g, node_t source, BFSDirection direction)
+{
+    return RunBFS<CSRNeighbors, CSRNeighbors>(g.n, g.adjs.targets.size(), CSRNeighbors { g.adjs }, [&g]() { return CSRNeighbors { g.InvAdjs() }; }, source, direction);
+}
+BFSTree BFS(const ExpansionView& g, node_t source, BFSDirection direction)
+{
+    const uint64_t arcNum = (g.posAdjs.targets.size() + g.negAdjs.targets.size()) << 1;
+    if (g.symmetric)
+        return RunBFS<ViewNeighbors, ViewNeighbors>(g.nodeNum(), arcNum, ViewNeighbors { g }, [&g]() { return ViewNeighbors { g }; }, source, direction);
+    // The transpose of the expansion is the expansion of the transposed arrays.
+    CSR invPosAdjs, invNegAdjs;
+    std::optional<ExpansionView> invView;
+    auto getIn = [&]() {
+        invPosAdjs = Transpose(g.posAdjs), invNegAdjs = Transpose(g.negAdjs);
+        invView.emplace(g.n, invPosAdjs, invNegAdjs, false);
+        return ViewNeighbors { *invView };
+    };
+    return RunBFS<ViewNeighbors, ViewNeighbors>(g.nodeNum(), arcNum, ViewNeighbors { g }, getIn, source, direction);
+}
+}
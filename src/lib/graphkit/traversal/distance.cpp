@@ -0,0 +1,226 @@
+#include "graphkit.h"
+#include "graphkitutils.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <exception>
+#include <format>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using gkit::node_t, gkit::CSR;
+using std::uint64_t;
+
+namespace {
+// Bound on the bitset memory of all threads; the batch width is halved until it fits.
+constexpr uint64_t msbfsMemory = uint64_t(1) << 30;
+constexpr unsigned msbfsMaxWords = 8;
+
+// One bit per source of a batch. The word loops are plain enough for the compiler to vectorize.
+template <unsigned Words>
+struct SourceBits {
+    std::array<uint64_t, Words> words {};
+    bool any() const
+    {
+        uint64_t acc = 0;
+        for (unsigned i = 0; i < Words; i++)
+            acc |= words[i];
+        return acc != 0;
+    }
+    unsigned count() const
+    {
+        unsigned c = 0;
+        for (unsigned i = 0; i < Words; i++)
+            c += std::popcount(words[i]);
+        return c;
+    }
+    void set(unsigned b) { words[b >> 6] |= uint64_t(1) << (b & 63); }
+    SourceBits& operator|=(const SourceBits& other)
+    {
+        for (unsigned i = 0; i < Words; i++)
+            words[i] |= other.words[i];
+        return *this;
+    }
+};
+
+struct BatchStats {
+    uint64_t pairNum = 0, distanceSum = 0;
+};
+
+// MS-BFS (Then et al.): all sources of a batch expand one level together, a node being pushed
+// once per level for every source whose frontier holds it.
+template <unsigned Words>
+struct MultiSourceBFS {
+    const CSR& adjs;
+    std::vector<SourceBits<Words>> seen, visit, next;
+    MultiSourceBFS(const CSR& adjs)
+        : adjs(adjs)
+        , seen(adjs.size())
+        , visit(adjs.size())
+        , next(adjs.size())
+    {
+    }
+    void run(const node_t* sources, unsigned sourceNum, node_t* ecc, BatchStats& stats)
+    {
+        const node_t n = adjs.size();
+        std::ranges::fill(seen, SourceBits<Words>()), std::ranges::fill(visit, SourceBits<Words>());
+        for (unsigned b = 0; b < sourceNum; b++) {
+            seen[sources[b]].set(b), visit[sources[b]].set(b);
+            ecc[b] = 0;
+        }
+        for (node_t level = 1;; level++) {
+            for (node_t u = 0; u < n; u++)
+                if (visit[u].any())
+                    for (const node_t& v : adjs[u])
+                        next[v] |= visit[u];
+            SourceBits<Words> reached;
+            for (node_t v = 0; v < n; v++) {
+                for (unsigned i = 0; i < Words; i++) {
+                    visit[v].words[i] = next[v].words[i] & ~seen[v].words[i];
+                    seen[v].words[i] |= visit[v].words[i];
+                    next[v].words[i] = 0;
+                }
+                reached |= visit[v];
+                const unsigned c = visit[v].count();
+                stats.pairNum += c, stats.distanceSum += uint64_t(c) * level;
+            }
+            if (!reached.any())
+                break;
+            for (unsigned i = 0; i < Words; i++)
+                for (uint64_t w = reached.words[i]; w != 0; w &= w - 1)
+                    ecc[(i << 6) + std::countr_zero(w)] = level;
+        }
+    }
+};
+
+template <unsigned Words>
+BatchStats RunBatches(const CSR& adjs, const std::vector<node_t>& sources, std::vector<node_t>& ecc, unsigned threadNum)
+{
+    constexpr uint64_t batchSize = Words * 64;
+    const uint64_t batchNum = (sources.size() + batchSize - 1) / batchSize;
+    std::vector<BatchStats> threadStats(threadNum);
+    std::atomic<uint64_t> nextBatch(0);
+    std::mutex spinnerMutex;
+    TickSpinner spinner("MS-BFS: Searching from source batches...", sources.size());
+    ParallelRun(threadNum, [&](unsigned t) {
+        MultiSourceBFS<Words> engine(adjs);
+        for (uint64_t b; (b = nextBatch.fetch_add(1, std::memory_order_relaxed)) < batchNum;) {
+            const uint64_t lo = b * batchSize, hi = std::min<uint64_t>(lo + batchSize, sources.size());
+            engine.run(sources.data() + lo, hi - lo, ecc.data() + lo, threadStats[t]);
+            std::lock_guard<std::mutex> lock(spinnerMutex);
+            spinner.tick(hi - lo);
+        }
+    });
+    spinner.markAsCompleted();
+    BatchStats stats;
+    for (const BatchStats& s : threadStats)
+        stats.pairNum += s.pairNum, stats.distanceSum += s.distanceSum;
+    return stats;
+}
+
+// Picks the widest batch that gives every thread a batch and keeps the bitsets within msbfsMemory.
+BatchStats SearchFrom(const CSR& adjs, const std::vector<node_t>& sources, std::vector<node_t>& ecc)
+{
+    const node_t n = adjs.size();
+    for (const node_t& s : sources) {
+        if (s >= n) {
+            std::string errStr = std::format("MS-BFS: source {} out of range [0, {})\n", s, n);
+            std::cerr << errStr;
+            std::terminate();
+        }
+    }
+    ecc.assign(sources.size(), 0);
+    if (sources.empty())
+        return {};
+    const unsigned threadNum = std::max<unsigned>(1, std::min<uint64_t>(gkit::GetThreadNum(), (sources.size() + 63) / 64));
+    unsigned words = msbfsMaxWords;
+    while (words > 1 && (sources.size() < uint64_t(words) * 64 * threadNum || uint64_t(n) * words * 24 * threadNum > msbfsMemory))
+        words >>= 1;
+    switch (words) {
+    case 8:
+        return RunBatches<8>(adjs, sources, ecc, threadNum);
+    case 4:
+        return RunBatches<4>(adjs, sources, ecc, threadNum);
+    case 2:
+        return RunBatches<2>(adjs, sources, ecc, threadNum);
+    default:
+        return RunBatches<1>(adjs, sources, ecc, threadNum);
+    }
+}
+
+gkit::DistanceStats AllDistances(const CSR& adjs)
+{
+    std::vector<node_t> sources(adjs.size());
+    for (node_t u = 0; u < adjs.size(); u++)
+        sources[u] = u;
+    gkit::DistanceStats stats;
+    const BatchStats batchStats = SearchFrom(adjs, sources, stats.eccentricity);
+    stats.diameter = stats.eccentricity.empty() ? 0 : std::ranges::max(stats.eccentricity);
+    stats.radius = stats.eccentricity.empty() ? 0 : std::ranges::min(stats.eccentricity);
+    stats.pairNum = batchStats.pairNum;
+    stats.averageDistance = batchStats.pairNum == 0 ? 0.0 : static_cast<double>(batchStats.distanceSum) / batchStats.pairNum;
+    return stats;
+}
+
+// Farthest node from the source of tree, the smallest one among ties.
+node_t Farthest(const gkit::BFSTree& tree)
+{
+    node_t far = tree.source;
+    for (node_t u = 0; u < tree.dist.size(); u++)
+        if (tree.reached(u) && tree.dist[u] > tree.dist[far])
+            far = u;
+    return far;
+}
+}
+
+namespace gkit {
+std::vector<node_t> Eccentricities(const SimpleUndiGraph& g, const std::vector<node_t>& sources)
+{
+    std::vector<node_t> ecc;
+    SearchFrom(g.adjs, sources, ecc);
+    return ecc;
+}
+std::vector<node_t> Eccentricities(const SimpleDiGraph& g, const std::vector<node_t>& sources)
+{
+    std::vector<node_t> ecc;
+    SearchFrom(g.adjs, sources, ecc);
+    return ecc;
+}
+DistanceStats AllDistances(const SimpleUndiGraph& g) { return ::AllDistances(g.adjs); }
+DistanceStats AllDistances(const SimpleDiGraph& g) { return ::AllDistances(g.adjs); }
+
+// The central node is the middle of a double sweep from the node of largest degree. With F_i the
+// nodes at distance i from it, every node up to level i has eccentricity at most 2i, so once the
+// best eccentricity found reaches 2i the levels left cannot beat it.
+node_t Diameter(const SimpleUndiGraph& g)
+{
+    if (g.n == 0)
+        return 0;
+    node_t start = 0;
+    for (node_t u = 1; u < g.n; u++)
+        if (g.adjs.degree(u) > g.adjs.degree(start))
+            start = u;
+    const node_t a = Farthest(BFS(g, start));
+    const BFSTree sweep = BFS(g, a);
+    node_t center = Farthest(sweep);
+    node_t lowerBound = sweep.dist[center];
+    for (node_t steps = sweep.dist[center] / 2; steps > 0; steps--)
+        center = sweep.parent[center];
+    const BFSTree tree = BFS(g, center);
+    const node_t ecc = tree.dist[Farthest(tree)];
+    std::vector<std::vector<node_t>> levels(ecc + 1);
+    for (node_t u = 0; u < g.n; u++)
+        if (tree.reached(u))
+            levels[tree.dist[u]].push_back(u);
+    lowerBound = std::max(lowerBound, ecc);
+    for (node_t i = ecc; i > 0 && lowerBound < 2 * i; i--) {
+        const std::vector<node_t> levelEcc = Eccentricities(g, levels[i]);
+        lowerBound = std::max(lowerBound, std::ranges::max(levelEcc));
+    }
+    return lowerBound;
+}
+}
@@ -0,0 +1,119 @@
+#include "graphkit.h"
+#include "graphkitcompact.h"
+#include "graphkitutils.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+using gkit::node_t, gkit::offset_t, gkit::CSR;
+using std::uint64_t;
+
+namespace {
+constexpr offset_t noArc = std::numeric_limits<offset_t>::max();
+
+// Per-thread state of Wilson's algorithm. nextArc[u] is an offset into adjs.targets, so the arc
+// counters need no search, and is overwritten as the walk revisits u, which erases the loops.
+struct WilsonSampler {
+    const CSR& adjs;
+    // A walk stops at u when a draw falls below stop[u].
+    const std::vector<uint64_t>& stop;
+    std::vector<offset_t> nextArc;
+    std::vector<std::uint8_t> inForest;
+    WilsonSampler(const CSR& adjs, const std::vector<uint64_t>& stop)
+        : adjs(adjs)
+        , stop(stop)
+        , nextArc(adjs.size())
+        , inForest(adjs.size())
+    {
+    }
+    // Returns the number of steps; fresh roots and arcs are reported through addRoot and addArc.
+    template <typename AddRoot, typename AddArc>
+    uint64_t run(gkit::StreamRNG& rng, bool tree, AddRoot&& addRoot, AddArc&& addArc)
+    {
+        const node_t n = adjs.size();
+        std::ranges::fill(inForest, 0);
+        if (tree) {
+            // The target of a uniform arc is a stationary node.
+            const node_t root = adjs.targets[rng.below(adjs.targets.size())];
+            inForest[root] = 1, nextArc[root] = noArc;
+            addRoot(root);
+        }
+        uint64_t steps = 0;
+        for (node_t start = 0; start < n; start++) {
+            for (node_t u = start; !inForest[u]; steps++) {
+                if (adjs.degree(u) == 0 || rng() < stop[u]) {
+                    inForest[u] = 1, nextArc[u] = noArc;
+                    addRoot(u);
+                    break;
+                }
+                nextArc[u] = adjs.offsets[u] + rng.below(adjs.degree(u));
+                u = adjs.targets[nextArc[u]];
+            }
+            for (node_t u = start; !inForest[u]; u = adjs.targets[nextArc[u]]) {
+                inForest[u] = 1;
+                addArc(nextArc[u]);
+            }
+        }
+        return steps;
+    }
+};
+}
+
+namespace gkit {
+// Roots and arcs are tallied in shared atomic counters, like the triangle counts.
+ForestStats SampleForests(const SimpleUndiGraph& g, double q, std::uint64_t sampleNum, std::uint64_t seed)
+{
+    const node_t n = g.n;
+    const CSR& adjs = g.adjs;
+    const uint64_t arcNum = adjs.targets.size();
+    const bool tree = q <= 0;
+    if (tree && n > 0) {
+        const std::vector<node_t> label = LabelCC(adjs);
+        if (arcNum == 0 || std::ranges::any_of(label, [&label](node_t l) { return l != label[0]; })) {
+            std::cerr << "SampleForests: spanning trees need a connected graph with an edge\n";
+            std::terminate();
+        }
+    }
+    std::vector<uint64_t> stop(n, 0);
+    if (!tree)
+        for (node_t u = 0; u < n; u++)
+            stop[u] = static_cast<uint64_t>(std::min(q / (q + adjs.degree(u)) * 0x1p64, 0x1p64 - 0x1p11));
+    std::unique_ptr<std::atomic<uint64_t>[]> rootCount(new std::atomic<uint64_t>[n]), arcCount(new std::atomic<uint64_t>[arcNum]);
+    ParallelFor(GetThreadNum(), 0, n, 1 << 16, [&](uint64_t u) { rootCount[u].store(0, std::memory_order_relaxed); });
+    ParallelFor(GetThreadNum(), 0, arcNum, 1 << 16, [&](uint64_t i) { arcCount[i].store(0, std::memory_order_relaxed); });
+    const unsigned threadNum = std::max<unsigned>(1, std::min<uint64_t>(GetThreadNum(), sampleNum));
+    const uint64_t key = SplitMix64(seed);
+    std::vector<uint64_t> threadSteps(threadNum);
+    std::atomic<uint64_t> nextSample(0);
+    std::mutex spinnerMutex;
+    TickSpinner spinner("Wilson: Sampling forests...", sampleNum);
+    ParallelRun(threadNum, [&](unsigned t) {
+        WilsonSampler sampler(adjs, stop);
+        for (uint64_t s; (s = nextSample.fetch_add(1, std::memory_order_relaxed)) < sampleNum;) {
+            StreamRNG rng { EdgeHash(key, s) };
+            threadSteps[t] += sampler.run(
+                rng, tree, [&](node_t u) { rootCount[u].fetch_add(1, std::memory_order_relaxed); },
+                [&](offset_t i) { arcCount[i].fetch_add(1, std::memory_order_relaxed); });
+            std::lock_guard<std::mutex> lock(spinnerMutex);
+            spinner.tick();
+        }
+    });
+    spinner.markAsCompleted();
+    ForestStats stats;
+    stats.sampleNum = sampleNum;
+    const double scale = sampleNum == 0 ? 0.0 : 1.0 / sampleNum;
+    stats.rootFrequency.resize(n), stats.arcFrequency.resize(arcNum);
+    ParallelFor(GetThreadNum(), 0, n, 1 << 16, [&](uint64_t u) { stats.rootFrequency[u] = rootCount[u].load(std::memory_order_relaxed) * scale; });
+    ParallelFor(GetThreadNum(), 0, arcNum, 1 << 16, [&](uint64_t i) { stats.arcFrequency[i] = arcCount[i].load(std::memory_order_relaxed) * scale; });
+    stats.rootNum = std::reduce(stats.rootFrequency.begin(), stats.rootFrequency.end(), 0.0);
+    stats.steps = std::reduce(threadSteps.begin(), threadSteps.end(), uint64_t(0)) * scale;
+    return stats;
+}
+}
@@ -0,0 +1,435 @@
+#include "graphkit.h"
+#include "graphkitcompact.h"
+#include "graphkitparser.h"
+#include "graphkitutils.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Walk corpus layout (native endianness):
+//   WalkHeader
+//   walkNum records of length + 1 node_t: the source, then the node after every step, padded
+//   with walkPad after a sink. Records have a fixed size, so chunks are written in place.
+using gkit::node_t, gkit::offset_t, gkit::CSR, gkit::WalkParams, gkit::StreamRNG;
+using std::uint64_t;
+
+namespace {
+constexpr node_t noNode = std::numeric_limits<node_t>::max();
+// Walkers a thread advances in lockstep, and walks handed out to a thread at a time.
+constexpr unsigned walkLanes = 32;
+constexpr uint64_t walkChunkSize = 1 << 12;
+
+struct WalkHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t nodeWidth;
+    std::uint64_t walkNum, length;
+};
+constexpr char walkMagic[8] = { 'G', 'K', 'I', 'T', 'W', 'A', 'L', 'K' };
+constexpr std::uint32_t walkVersion = 1;
+
+// Vose's construction: weights are scaled to mean 1, and every entry below 1 is topped up from
+// one above 1, which becomes its alias. A zero total gives the uniform table.
+template <typename Index>
+void BuildAlias(const double* weights, uint64_t size, double* prob, Index* alias, std::vector<Index>& small, std::vector<Index>& large)
+{
+    double sum = 0;
+    for (uint64_t i = 0; i < size; i++) {
+        if (!(weights[i] >= 0) || std::isinf(weights[i])) {
+            std::cerr << "Alias table: weights must be finite and non-negative\n";
+            std::terminate();
+        }
+        sum += weights[i];
+    }
+    small.clear(), large.clear();
+    for (uint64_t i = 0; i < size; i++) {
+        prob[i] = sum > 0 ? weights[i] * size / sum : 1.0;
+        alias[i] = i;
+        (prob[i] < 1 ? small : large).push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+        const Index s = small.back(), l = large.back();
+        small.pop_back();
+        alias[s] = l;
+        prob[l] -= 1 - prob[s];
+        if (prob[l] < 1)
+            large.pop_back(), small.push_back(l);
+    }
+    // Rounding leftovers are full columns.
+    for (const Index& i : small)
+        prob[i] = 1;
+    for (const Index& i : large)
+        prob[i] = 1;
+}
+
+struct Walker {
+    static constexpr uint64_t idle = std::numeric_limits<uint64_t>::max();
+    uint64_t walk, steps;
+    node_t source, prev, cur;
+    StreamRNG rng;
+};
+
+// One step from the current node of a walker: an arc by weight or uniformly, accepted with the
+// node2vec bias over its maximum. The bias finds common neighbors by binary search, so a biased
+// walk checks that the out-lists are sorted; a CSR built from nested vectors may not be.
+struct Mover {
+    const CSR& adjs;
+    std::vector<double> prob;
+    std::vector<node_t> alias;
+    double returnBias, inOutBias, maxBias;
+    bool biased;
+    Mover(const CSR& adjs, const WalkParams& params)
+        : adjs(adjs)
+        , returnBias(1 / params.returnParam)
+        , inOutBias(1 / params.inOutParam)
+        , maxBias(std::max({ returnBias, 1.0, inOutBias }))
+        , biased(params.returnParam != 1 || params.inOutParam != 1)
+    {
+        if (!(params.returnParam > 0) || !(params.inOutParam > 0)) {
+            std::cerr << "Walks: node2vec parameters must be positive\n";
+            std::terminate();
+        }
+        if (biased) {
+            std::atomic<bool> unsorted = false;
+            ParallelFor(gkit::GetThreadNum(), 0, adjs.size(), 1 << 10, [&](uint64_t u) {
+                if (!std::ranges::is_sorted(adjs[u]))
+                    unsorted.store(true, std::memory_order_relaxed);
+            });
+            if (unsorted) {
+                std::cerr << "Walks: node2vec bias needs sorted out-lists\n";
+                std::terminate();
+            }
+        }
+        if (params.arcWeights.empty())
+            return;
+        if (params.arcWeights.size() != adjs.targets.size()) {
+            std::string errStr = std::format("Walks: {} arc weights for {} arcs\n", params.arcWeights.size(), adjs.targets.size());
+            std::cerr << errStr;
+            std::terminate();
+        }
+        prob.resize(adjs.targets.size()), alias.resize(adjs.targets.size());
+        ParallelFor(gkit::GetThreadNum(), 0, adjs.size(), 1 << 10, [&](uint64_t u) {
+            thread_local std::vector<node_t> small, large;
+            const offset_t lo = adjs.offsets[u];
+            BuildAlias(params.arcWeights.data() + lo, adjs.degree(u), prob.data() + lo, alias.data() + lo, small, large);
+        });
+    }
+    // Next node, or noNode at a sink.
+    node_t next(Walker& w) const
+    {
+        const node_t degr = adjs.degree(w.cur);
+        if (degr == 0)
+            return noNode;
+        const offset_t lo = adjs.offsets[w.cur];
+        while (true) {
+            node_t i = w.rng.below(degr);
+            if (!prob.empty() && w.rng.uniform() >= prob[lo + i])
+                i = alias[lo + i];
+            const node_t v = adjs.targets[lo + i];
+            if (!biased || w.prev == noNode)
+                return v;
+            const double bias = v == w.prev ? returnBias : std::ranges::binary_search(adjs[w.prev], v) ? 1.0 : inOutBias;
+            if (w.rng.uniform() * maxBias < bias)
+                return v;
+        }
+    }
+    // The next step reads the offsets of v, so they are fetched while the other lanes move.
+    void moveTo(Walker& w, node_t v) const
+    {
+        __builtin_prefetch(adjs.offsets.data() + v);
+        w.prev = w.cur, w.cur = v, w.steps++;
+    }
+};
+
+// Runs walkNum walks on GetThreadNum() threads. A thread takes walkChunkSize walks at a time and
+// keeps walkLanes of them in flight, advancing every lane by one step per round so that their
+// cache misses overlap; a lane whose walk ends takes the next one. makeWorker() gives each thread
+// a worker with begin(lo, hi) and end(lo, hi) around every chunk, start(w) placing a fresh walker
+// and step(w) advancing it, false once the walk is over.
+template <typename MakeWorker>
+void RunWalks(uint64_t walkNum, uint64_t seed, const char* text, MakeWorker&& makeWorker)
+{
+    const uint64_t chunkNum = (walkNum + walkChunkSize - 1) / walkChunkSize;
+    const unsigned threadNum = std::max<unsigned>(1, std::min<uint64_t>(gkit::GetThreadNum(), chunkNum));
+    const uint64_t key = gkit::SplitMix64(seed);
+    std::atomic<uint64_t> nextChunk(0);
+    std::mutex spinnerMutex;
+    TickSpinner spinner(text, walkNum);
+    ParallelRun(threadNum, [&](unsigned) {
+        auto worker = makeWorker();
+        std::array<Walker, walkLanes> lanes;
+        for (uint64_t c; (c = nextChunk.fetch_add(1, std::memory_order_relaxed)) < chunkNum;) {
+            const uint64_t lo = c * walkChunkSize, hi = std::min<uint64_t>(lo + walkChunkSize, walkNum);
+            uint64_t nextWalk = lo;
+            unsigned active = 0;
+            auto launch = [&](Walker& w) {
+                w.walk = nextWalk++, w.steps = 0, w.prev = noNode;
+                w.rng = StreamRNG { gkit::EdgeHash(key, w.walk) };
+                worker.start(w);
+            };
+            worker.begin(lo, hi);
+            for (Walker& w : lanes) {
+                w.walk = Walker::idle;
+                if (nextWalk < hi)
+                    launch(w), active++;
+            }
+            while (active > 0) {
+                for (Walker& w : lanes) {
+                    if (w.walk == Walker::idle || worker.step(w))
+                        continue;
+                    if (nextWalk < hi)
+                        launch(w);
+                    else
+                        w.walk = Walker::idle, active--;
+                }
+            }
+            worker.end(lo, hi);
+            std::lock_guard<std::mutex> lock(spinnerMutex);
+            spinner.tick(hi - lo);
+        }
+    });
+    spinner.markAsCompleted();
+}
+
+void CheckNode(node_t u, node_t n)
+{
+    if (u >= n) {
+        std::string errStr = std::format("Walks: node {} out of range [0, {})\n", u, n);
+        std::cerr << errStr;
+        std::terminate();
+    }
+}
+
+bool WriteAt(int fd, const void* data, uint64_t size, uint64_t pos)
+{
+    const char* bytes = static_cast<const char*>(data);
+    uint64_t written = 0;
+    for (ssize_t n; written < size; written += n)
+        if ((n = pwrite(fd, bytes + written, size - written, pos + written)) <= 0)
+            break;
+    return written == size;
+}
+
+// Every chunk of records is filled in a buffer and written at its own offset with pwrite.
+void WriteWalks(const CSR& adjs, const WalkParams& params, uint64_t walksPerNode, uint64_t seed, const std::filesystem::path& path)
+{
+    const node_t n = adjs.size();
+    const uint64_t walkNum = uint64_t(n) * walksPerNode, recordSize = params.length + 1;
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::string errStr = std::format("Failed to create file: {}\n", path.string());
+        std::cerr << errStr;
+        std::terminate();
+    }
+    WalkHeader header { {}, walkVersion, sizeof(node_t), walkNum, params.length };
+    std::memcpy(header.magic, walkMagic, sizeof(walkMagic));
+    std::atomic<bool> failed(!WriteAt(fd, &header, sizeof(header), 0));
+    const Mover mover(adjs, params);
+    struct Worker {
+        const Mover& mover;
+        const WalkParams& params;
+        node_t n;
+        uint64_t recordSize;
+        int fd;
+        std::atomic<bool>& failed;
+        std::vector<node_t> buffer;
+        uint64_t base;
+        void begin(uint64_t lo, uint64_t hi) { buffer.assign((hi - lo) * recordSize, gkit::walkPad), base = lo; }
+        void start(Walker& w)
+        {
+            w.source = w.cur = w.walk % n;
+            buffer[(w.walk - base) * recordSize] = w.source;
+        }
+        bool step(Walker& w)
+        {
+            if (w.steps == params.length)
+                return false;
+            node_t v;
+            if (params.restartProb > 0 && w.rng.uniform() < params.restartProb) {
+                v = w.source;
+                w.cur = noNode;
+            } else if ((v = mover.next(w)) == noNode) {
+                return false;
+            }
+            mover.moveTo(w, v);
+            buffer[(w.walk - base) * recordSize + w.steps] = v;
+            return true;
+        }
+        void end(uint64_t lo, uint64_t)
+        {
+            if (!WriteAt(fd, buffer.data(), buffer.size() * sizeof(node_t), sizeof(WalkHeader) + lo * recordSize * sizeof(node_t)))
+                failed = true;
+        }
+    };
+    RunWalks(walkNum, seed, "Walks: Writing corpus...", [&]() { return Worker { mover, params, n, recordSize, fd, failed, {}, 0 }; });
+    if (close(fd) != 0 || failed) {
+        std::string errStr = std::format("Failed to write walks: {}\n", path.string());
+        std::cerr << errStr;
+        std::terminate();
+    }
+}
+
+std::vector<double> PersonalizedPageRank(const CSR& adjs, const gkit::AliasTable& personalization, const WalkParams& params, uint64_t walkNum, uint64_t seed)
+{
+    const node_t n = adjs.size();
+    if (personalization.prob.size() != n || !(params.restartProb > 0)) {
+        std::cerr << "PersonalizedPageRank: needs one personalization weight per node and a positive restartProb\n";
+        std::terminate();
+    }
+    std::unique_ptr<std::atomic<uint64_t>[]> visits(new std::atomic<uint64_t>[n]);
+    ParallelFor(gkit::GetThreadNum(), 0, n, 1 << 16, [&](uint64_t u) { visits[u].store(0, std::memory_order_relaxed); });
+    const Mover mover(adjs, params);
+    struct Worker {
+        const Mover& mover;
+        const gkit::AliasTable& personalization;
+        const WalkParams& params;
+        std::atomic<uint64_t>* visits;
+        void begin(uint64_t, uint64_t) { }
+        void end(uint64_t, uint64_t) { }
+        void start(Walker& w)
+        {
+            w.source = w.cur = personalization.sample(w.rng);
+            visits[w.cur].fetch_add(1, std::memory_order_relaxed);
+        }
+        bool step(Walker& w)
+        {
+            if (w.steps == params.length || w.rng.uniform() < params.restartProb)
+                return false;
+            node_t v = mover.next(w);
+            if (v == noNode)
+                v = personalization.sample(w.rng), w.cur = noNode;
+            mover.moveTo(w, v);
+            visits[v].fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    };
+    RunWalks(walkNum, seed, "PPR: Walking...", [&]() { return Worker { mover, personalization, params, visits.get() }; });
+    // Every visit stands for restartProb of the mass of one walk.
+    std::vector<double> ppr(n);
+    const double scale = walkNum == 0 ? 0.0 : params.restartProb / walkNum;
+    ParallelFor(gkit::GetThreadNum(), 0, n, 1 << 16, [&](uint64_t u) { ppr[u] = visits[u].load(std::memory_order_relaxed) * scale; });
+    return ppr;
+}
+
+std::vector<double> HittingTimes(const CSR& adjs, const std::vector<node_t>& sources, node_t target, const WalkParams& params, uint64_t walksPerSource, uint64_t seed)
+{
+    CheckNode(target, adjs.size());
+    for (const node_t& s : sources)
+        CheckNode(s, adjs.size());
+    std::unique_ptr<std::atomic<uint64_t>[]> steps(new std::atomic<uint64_t>[sources.size()]);
+    for (uint64_t i = 0; i < sources.size(); i++)
+        steps[i].store(0, std::memory_order_relaxed);
+    const Mover mover(adjs, params);
+    struct Worker {
+        const Mover& mover;
+        const std::vector<node_t>& sources;
+        node_t target;
+        const WalkParams& params;
+        uint64_t walksPerSource;
+        std::atomic<uint64_t>* steps;
+        void begin(uint64_t, uint64_t) { }
+        void end(uint64_t, uint64_t) { }
+        void start(Walker& w) { w.source = w.cur = sources[w.walk / walksPerSource]; }
+        bool step(Walker& w)
+        {
+            node_t v = noNode;
+            if (w.cur != target && w.steps < params.length && (v = mover.next(w)) != noNode) {
+                mover.moveTo(w, v);
+                return true;
+            }
+            steps[w.walk / walksPerSource].fetch_add(w.cur == target ? w.steps : params.length, std::memory_order_relaxed);
+            return false;
+        }
+    };
+    RunWalks(sources.size() * walksPerSource, seed, "Hitting: Walking...", [&]() { return Worker { mover, sources, target, params, walksPerSource, steps.get() }; });
+    std::vector<double> mean(sources.size());
+    for (uint64_t i = 0; i < sources.size(); i++)
+        mean[i] = walksPerSource == 0 ? 0.0 : static_cast<double>(steps[i].load(std::memory_order_relaxed)) / walksPerSource;
+    return mean;
+}
+
+// The second direction gets a derived seed, so the two estimates are independent.
+double CommuteTime(const CSR& adjs, node_t u, node_t v, const WalkParams& params, uint64_t walkNum, uint64_t seed)
+{
+    return HittingTimes(adjs, { u }, v, params, walkNum, seed)[0] + HittingTimes(adjs, { v }, u, params, walkNum, gkit::SplitMix64(seed))[0];
+}
+}
+
+namespace gkit {
+AliasTable::AliasTable(std::span<const double> weights)
+    : prob(weights.size())
+    , alias(weights.size())
+{
+    if (std::ranges::all_of(weights, [](double x) { return x == 0; })) {
+        std::cerr << "Alias table: weights must not all be 0\n";
+        std::terminate();
+    }
+    std::vector<std::uint64_t> small, large;
+    BuildAlias(weights.data(), weights.size(), prob.data(), alias.data(), small, large);
+}
+
+void WriteWalks(const SimpleUndiGraph& g, const WalkParams& params, std::uint64_t walksPerNode, std::uint64_t seed, const std::filesystem::path& path) { ::WriteWalks(g.adjs, params, walksPerNode, seed, path); }
+void WriteWalks(const SimpleDiGraph& g, const WalkParams& params, std::uint64_t walksPerNode, std::uint64_t seed, const std::filesystem::path& path) { ::WriteWalks(g.adjs, params, walksPerNode, seed, path); }
+
+void ReadWalks(const std::filesystem::path& path, const std::function<void(std::span<const node_t>)>& f)
+{
+    const MappedFile file(path);
+    auto fail = [&path](const std::string& reason) {
+        std::string errStr = std::format("Failed to load walks {}: {}\n", path.string(), reason);
+        std::cerr << errStr;
+        std::terminate();
+    };
+    WalkHeader header;
+    if (file.size < sizeof(header))
+        fail("truncated header");
+    std::memcpy(&header, file.data, sizeof(header));
+    if (std::memcmp(header.magic, walkMagic, sizeof(walkMagic)) != 0)
+        fail("bad magic");
+    if (header.version != walkVersion)
+        fail(std::format("unsupported version {}", header.version));
+    if (header.nodeWidth != sizeof(node_t))
+        fail(std::format("stored with {}-byte node IDs, expected {}", header.nodeWidth, sizeof(node_t)));
+    const uint64_t recordSize = header.length + 1;
+    if ((file.size - sizeof(header)) / sizeof(node_t) / recordSize < header.walkNum)
+        fail("truncated walks");
+    const node_t* records = reinterpret_cast<const node_t*>(file.data + sizeof(header));
+    for (uint64_t i = 0; i < header.walkNum; i++) {
+        const node_t* walk = records + i * recordSize;
+        f({ walk, static_cast<std::size_t>(std::find(walk, walk + recordSize, walkPad) - walk) });
+    }
+}
+
+std::vector<double> PersonalizedPageRank(const SimpleUndiGraph& g, const AliasTable& personalization, const WalkParams& params, std::uint64_t walkNum, std::uint64_t seed)
+{
+    return ::PersonalizedPageRank(g.adjs, personalization, params, walkNum, seed);
+}
+std::vector<double> PersonalizedPageRank(const SimpleDiGraph& g, const AliasTable& personalization, const WalkParams& params, std::uint64_t walkNum, std::uint64_t seed)
+{
+    return ::PersonalizedPageRank(g.adjs, personalization, params, walkNum, seed);
+}
+
+std::vector<double> HittingTimes(const SimpleUndiGraph& g, const std::vector<node_t>& sources, node_t target, const WalkParams& params, std::uint64_t walksPerSource, std::uint64_t seed)
+{
+    return ::HittingTimes(g.adjs, sources, target, params, walksPerSource, seed);
+}
+std::vector<double> HittingTimes(const SimpleDiGraph& g, const std::vector<node_t>& sources, node_t target, const WalkParams& params, std::uint64_t walksPerSource, std::uint64_t seed)
+{
+    return ::HittingTimes(g.adjs, sources, target, params, walksPerSource, seed);
+}
+
+double CommuteTime(const SimpleUndiGraph& g, node_t u, node_t v, const WalkParams& params, std::uint64_t walkNum, std::uint64_t seed) { return ::CommuteTime(g.adjs, u, v, params, walkNum, seed); }
+double CommuteTime(const SimpleDiGraph& g, node_t u, node_t v, const WalkParams& params, std::uint64_t walkNum, std::uint64_t seed) { return ::CommuteTime(g.adjs, u, v, params, walkNum, seed); }
+}
@@ -0,0 +1,121 @@
+#include "graphkit.h"
+#include "graphkitcompact.h"
+#include "graphkitutils.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+using gkit::node_t, gkit::CSR;
+using std::uint64_t;
+
+namespace {
+// Ranks handed out at a time; small, since the lists of low ranks are the long ones.
+constexpr uint64_t triangleBlockSize = 1 << 8;
+
+// Ranks order nodes by (degree, node), and rank r points to the larger ranks among its neighbours,
+// in increasing order. Every triangle is then found once, from its smallest rank, and no list is
+// longer than about sqrt(2m).
+struct OrientedGraph {
+    std::vector<node_t> order;
+    CSR adjs;
+    OrientedGraph(const CSR& undiAdjs)
+        : order(undiAdjs.size())
+    {
+        const node_t n = undiAdjs.size();
+        const unsigned threadNum = gkit::GetThreadNum();
+        std::iota(order.begin(), order.end(), node_t(0));
+        std::ranges::sort(order, [&undiAdjs](node_t u, node_t v) { return undiAdjs.degree(u) < undiAdjs.degree(v) || (undiAdjs.degree(u) == undiAdjs.degree(v) && u < v); });
+        std::vector<node_t> rank(n), degr(n);
+        for (node_t r = 0; r < n; r++)
+            rank[order[r]] = r;
+        ParallelFor(threadNum, 0, n, triangleBlockSize, [&](uint64_t r) {
+            degr[r] = std::ranges::count_if(undiAdjs[order[r]], [&rank, r](node_t v) { return rank[v] > r; });
+        });
+        gkit::CSRFiller filler(adjs, std::move(degr));
+        ParallelFor(threadNum, 0, n, triangleBlockSize, [&](uint64_t r) {
+            for (const node_t& v : undiAdjs[order[r]])
+                if (rank[v] > r)
+                    filler.add(r, rank[v]);
+            std::ranges::sort(adjs[r]);
+        });
+    }
+};
+
+// Runs countFrom(r, ...) for every rank on GetThreadNum() threads and sums what it returns.
+template <typename F>
+uint64_t SumOverRanks(node_t n, F&& countFrom)
+{
+    const uint64_t blockNum = (uint64_t(n) + triangleBlockSize - 1) / triangleBlockSize;
+    std::vector<uint64_t> blockCount(blockNum);
+    std::mutex spinnerMutex;
+    TickSpinner spinner("Triangles: Intersecting oriented lists...", n);
+    ParallelFor(gkit::GetThreadNum(), 0, blockNum, 1, [&](uint64_t b) {
+        const uint64_t lo = b * triangleBlockSize, hi = std::min<uint64_t>(lo + triangleBlockSize, n);
+        std::vector<node_t> common;
+        for (uint64_t r = lo; r < hi; r++)
+            blockCount[b] += countFrom(r, common);
+        std::lock_guard<std::mutex> lock(spinnerMutex);
+        spinner.tick(hi - lo);
+    });
+    spinner.markAsCompleted();
+    return std::reduce(blockCount.begin(), blockCount.end(), uint64_t(0));
+}
+}
+
+namespace gkit {
+std::uint64_t TriangleNum(const SimpleUndiGraph& g)
+{
+    const OrientedGraph oriented(g.adjs);
+    const CSR& adjs = oriented.adjs;
+    const IntersectFunction intersect = GetIntersectFunction(GetIntersectionKernel(), false);
+    return SumOverRanks(g.n, [&](node_t r, std::vector<node_t>&) {
+        uint64_t count = 0;
+        for (const node_t& s : adjs[r])
+            count += intersect(adjs[r].data(), adjs.degree(r), adjs[s].data(), adjs.degree(s), nullptr);
+        return count;
+    });
+}
+
+// Every triangle is credited to its smallest rank r on the thread owning r, and to the other two
+// corners through atomic counters.
+TriangleStats CountTriangles(const SimpleUndiGraph& g)
+{
+    const node_t n = g.n;
+    const OrientedGraph oriented(g.adjs);
+    const CSR& adjs = oriented.adjs;
+    const IntersectFunction intersect = GetIntersectFunction(GetIntersectionKernel(), true);
+    std::unique_ptr<std::atomic<uint64_t>[]> count(new std::atomic<uint64_t>[n]);
+    ParallelFor(GetThreadNum(), 0, n, triangleBlockSize, [&](uint64_t r) { count[r].store(0, std::memory_order_relaxed); });
+    TriangleStats stats;
+    stats.triangleNum = SumOverRanks(n, [&](node_t r, std::vector<node_t>& common) {
+        uint64_t rCount = 0;
+        common.resize(adjs.degree(r));
+        for (const node_t& s : adjs[r]) {
+            const uint64_t sCount = intersect(adjs[r].data(), adjs.degree(r), adjs[s].data(), adjs.degree(s), common.data());
+            rCount += sCount;
+            count[s].fetch_add(sCount, std::memory_order_relaxed);
+            for (uint64_t i = 0; i < sCount; i++)
+                count[common[i]].fetch_add(1, std::memory_order_relaxed);
+        }
+        count[r].fetch_add(rCount, std::memory_order_relaxed);
+        return rCount;
+    });
+    stats.triangles.resize(n), stats.clustering.resize(n);
+    double clusteringSum = 0, wedgeNum = 0;
+    for (node_t r = 0; r < n; r++) {
+        const node_t u = oriented.order[r];
+        const double degr = g.adjs.degree(u), wedges = degr * (degr - 1) / 2;
+        stats.triangles[u] = count[r].load(std::memory_order_relaxed);
+        stats.clustering[u] = degr < 2 ? 0.0 : stats.triangles[u] / wedges;
+        clusteringSum += stats.clustering[u];
+        wedgeNum += degr < 2 ? 0.0 : wedges;
+    }
+    stats.averageClustering = n == 0 ? 0.0 : clusteringSum / n;
+    stats.transitivity = wedgeNum == 0 ? 0.0 : 3 * stats.triangleNum / wedgeNum;
+    return stats;
+}
+}
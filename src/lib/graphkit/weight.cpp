@@ -0,0 +1,42 @@
+#include "graphkit.h"
+#include "graphkitcompact.h"
+#include "graphkitutils.h"
+#include <algorithm>
+#include <cstdint>
+#include <span>
+
+namespace gkit {
+constexpr std::uint64_t fillBlockSize = 1 << 16;
+
+WeightFiller UniformWeights(std::uint64_t seed, weight_t lo, weight_t hi)
+{
+    const std::uint64_t key = SplitMix64(seed);
+    // 0 stands for the whole 64-bit range.
+    const std::uint64_t range = static_cast<std::uint64_t>(hi) - static_cast<std::uint64_t>(lo) + 1;
+    return [key, lo, range](std::uint64_t first, std::span<weight_t> weights) {
+        for (std::size_t i = 0; i < weights.size(); i++) {
+            const std::uint64_t x = EdgeHash(key, first + i);
+            const std::uint64_t offset = range == 0 ? x : static_cast<std::uint64_t>((static_cast<unsigned __int128>(x) * range) >> 64);
+            weights[i] = static_cast<weight_t>(static_cast<std::uint64_t>(lo) + offset);
+        }
+    };
+}
+WeightFiller SignWeights(std::uint64_t seed, double negRatio)
+{
+    const std::uint64_t key = SplitMix64(seed);
+    const double threshold = std::clamp(negRatio, 0.0, 1.0) * 0x1p64;
+    return [key, threshold](std::uint64_t first, std::span<weight_t> weights) {
+        for (std::size_t i = 0; i < weights.size(); i++)
+            weights[i] = static_cast<double>(EdgeHash(key, first + i)) < threshold ? -1 : 1;
+    };
+}
+
+void FillWeights(const WeightFiller& filler, std::span<weight_t> weights, std::uint64_t first)
+{
+    const std::uint64_t blockNum = (weights.size() + fillBlockSize - 1) / fillBlockSize;
+    ParallelFor(GetThreadNum(), 0, blockNum, 1, [&](std::uint64_t b) {
+        const std::uint64_t lo = b * fillBlockSize;
+        filler(first + lo, weights.subspan(lo, std::min<std::uint64_t>(fillBlockSize, weights.size() - lo)));
+    });
+}
+}
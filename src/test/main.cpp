@@ -1,9 +1,14 @@
 #include "graphkit.h"
+#include <Eigen/IterativeLinearSolvers>
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <format>
 #include <fstream>
 #include <iostream>
+#include <span>
 #include <string>
+#include <thread>
 
 void KonectTest()
 {
@@ -47,6 +52,143 @@ void ExpansionTest()
     fout2 << g.expansion();
 }
 
+void ParallelIngestTest()
+{
+    std::string url = "https://snap.stanford.edu/data/facebook_combined.txt.gz";
+    const std::filesystem::path source = gkit::GetSnapPath(url);
+    gkit::SetThreadNum(1);
+    gkit::UnweightedUndiGraph serialG("facebook", source);
+    gkit::SetThreadNum(std::thread::hardware_concurrency());
+    gkit::UnweightedUndiGraph parallelG("facebook", source);
+    std::cout << std::format("parallel ingest matches serial: {}.\n", serialG.edges == parallelG.edges);
+}
+
+void DirectBuildTest()
+{
+    std::string internalName = "p2p-Gnutella30";
+    const std::filesystem::path source = gkit::GetKonectPath(internalName);
+    gkit::SimpleDiGraph directG("Gnutella30", source);
+    gkit::SimpleDiGraph viaRawG(gkit::UnweightedDiGraph("Gnutella30", source));
+    std::cout << std::format("direct build: ({}, {}), via raw graph: ({}, {}).\n", directG.nodeNum(), directG.edgeNum(), viaRawG.nodeNum(), viaRawG.edgeNum());
+}
+
+void SnapshotTest()
+{
+    std::string internalName("convote");
+    gkit::SignedDiGraph g = gkit::LoadKonect<gkit::SignedDiGraph>(internalName, "Congress votes");
+    const std::filesystem::path path = std::filesystem::path(PROJECT_DIR) / "tmp" / "convote.gks";
+    g.save(path);
+    gkit::SignedDiGraph loadedG = gkit::SignedDiGraph::load(path);
+    std::cout << std::format("snapshot round trip matches: {}.\n", g.posAdjs == loadedG.posAdjs && g.negAdjs == loadedG.negAdjs);
+}
+
+void CacheTest()
+{
+    std::string internalName = "p2p-Gnutella30";
+    for (int i = 0; i < 2; i++) {
+        const auto beginTime = std::chrono::steady_clock::now();
+        gkit::SimpleDiGraph g = gkit::LoadKonect<gkit::SimpleDiGraph>(internalName, "Gnutella30");
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - beginTime;
+        std::cout << std::format("load #{} of ({}, {}) took {:.3f}s.\n", i, g.nodeNum(), g.edgeNum(), elapsed.count());
+    }
+}
+
+void WeightFillerTest()
+{
+    std::string url = "https://snap.stanford.edu/data/facebook_combined.txt.gz";
+    const std::filesystem::path source = gkit::GetSnapPath(url);
+    gkit::SetThreadNum(1);
+    gkit::WeightedUndiGraph serialG("facebook", source, gkit::UniformWeights(42, 1, 100));
+    gkit::SetThreadNum(std::thread::hardware_concurrency());
+    gkit::WeightedUndiGraph parallelG("facebook", source, gkit::UniformWeights(42, 1, 100));
+    std::cout << std::format("weights independent of thread count: {}.\n", serialG.edges == parallelG.edges);
+}
+
+void ComponentsTest()
+{
+    std::string internalName = "p2p-Gnutella30";
+    gkit::UnweightedDiGraph g("Gnutella30", gkit::GetKonectPath(internalName));
+    const gkit::Components comps = gkit::FindComponents(g);
+    std::cout << std::format("{} SCCs, largest sizes {} and {}.\n", comps.componentNum(), comps.sizes[0], comps.sizes[1]);
+    for (const auto& [size, count] : comps.sizeHistogram())
+        std::cout << std::format("{} SCCs of size {}.\n", count, size);
+    for (const gkit::SimpleDiGraph& sccG : gkit::TopComponents(g, comps, 2))
+        std::cout << std::format("{}: ({}, {}).\n", sccG.name, sccG.nodeNum(), sccG.edgeNum());
+}
+
+void BFSTest()
+{
+    const gkit::SimpleUndiGraph g = gkit::LoadPseudo(8);
+    const gkit::BFSTree pushTree = gkit::BFS(g, 0, gkit::BFSDirection::TopDown), tree = gkit::BFS(g, 0);
+    std::cout << std::format("{}: eccentricity of node 0 is {}, same distances both ways: {}.\n", g.name, std::ranges::max(tree.dist), tree.dist == pushTree.dist);
+}
+
+void DistanceTest()
+{
+    const gkit::SimpleUndiGraph g = gkit::LoadKoch(6);
+    const gkit::DistanceStats stats = gkit::AllDistances(g);
+    std::cout << std::format("{}: diameter {}, radius {}, average distance {:.4f}, iFUB diameter {}.\n", g.name, stats.diameter, stats.radius, stats.averageDistance, gkit::Diameter(g));
+}
+
+void TriangleTest()
+{
+    const gkit::SimpleUndiGraph g = gkit::LoadApollo(8);
+    const gkit::TriangleStats stats = gkit::CountTriangles(g);
+    std::cout << std::format("{}: {} triangles, average clustering {:.4f}, transitivity {:.4f}.\n", g.name, stats.triangleNum, stats.averageClustering, stats.transitivity);
+}
+
+void LaplacianTest()
+{
+    const gkit::SimpleUndiGraph g = gkit::LoadPseudo(8);
+    const gkit::LaplacianOperator lap = g.laplacian();
+    Eigen::VectorXd b = Eigen::VectorXd::Zero(g.nodeNum());
+    b[0] = 1, b[1] = -1;
+    Eigen::ConjugateGradient<gkit::LaplacianOperator, Eigen::Lower | Eigen::Upper, Eigen::IdentityPreconditioner> cg(lap);
+    const Eigen::VectorXd x = cg.solve(b);
+    std::cout << std::format("{}: effective resistance between 0 and 1 is {:.6f} after {} CG iterations.\n", g.name, x[0] - x[1], cg.iterations());
+}
+
+void LaplacianSolverTest()
+{
+    const gkit::SimpleUndiGraph g = gkit::LoadKoch(4);
+    const gkit::LaplacianSolver solver(g, gkit::LaplacianPreconditioner::IncompleteCholesky);
+    const gkit::ResistanceSketch sketch(solver, gkit::ResistanceSketch::dimension(g.nodeNum(), 0.3), 42);
+    std::cout << std::format("{}: R(0, 1) is {:.6f}, sketched {:.6f}.\n", g.name, solver.resistance(0, 1), sketch.resistance(0, 1));
+    std::cout << std::format("{}: Kirchhoff index {:.3f}, sketched {:.3f}; Kemeny constant {:.3f}, sketched {:.3f}.\n", g.name, gkit::KirchhoffIndex(solver), sketch.kirchhoffIndex(),
+        gkit::KemenyConstant(solver), sketch.kemenyConstant());
+}
+
+void ForestTest()
+{
+    const gkit::SimpleUndiGraph g = gkit::LoadApollo(4);
+    const gkit::ForestStats forests = gkit::SampleForests(g, 1.0, 10000, 42), trees = gkit::SampleForests(g, 0.0, 10000, 42);
+    std::cout << std::format("{}: {:.3f} roots per forest with q = 1; Kemeny constant {:.3f}, from trees {:.3f}.\n", g.name, forests.rootNum,
+        gkit::KemenyConstant(gkit::LaplacianSolver(g)), trees.kemenyConstant());
+}
+
+void WalkTest()
+{
+    const gkit::SimpleUndiGraph g = gkit::LoadKoch(3);
+    const std::filesystem::path path = std::filesystem::path(PROJECT_DIR) / "tmp" / "koch_walks.bin";
+    gkit::WalkParams params;
+    params.returnParam = 0.5, params.inOutParam = 2;
+    gkit::WriteWalks(g, params, 10, 42, path);
+    std::uint64_t walkNum = 0, stepNum = 0;
+    gkit::ReadWalks(path, [&](std::span<const gkit::node_t> walk) { walkNum++, stepNum += walk.size() - 1; });
+    std::cout << std::format("{}: {} walks with {} steps read back.\n", g.name, walkNum, stepNum);
+    params = gkit::WalkParams();
+    const double commute = gkit::CommuteTime(g, 0, 1, params, 10000, 42);
+    std::cout << std::format("{}: commute time between 0 and 1 is {:.3f}, 2m R(0, 1) is {:.3f}.\n", g.name, commute, 2.0 * g.m * gkit::LaplacianSolver(g).resistance(0, 1));
+}
+
+// Expects a local server that honours Range requests, e.g. `python3 -m RangeHTTPServer 8000` in tmp/.
+void DownloadTest()
+{
+    const std::filesystem::path tmpDir = std::filesystem::path(PROJECT_DIR) / "tmp";
+    gkit::DownloadFile("http://127.0.0.1:8000/convote.gks", tmpDir / "convote_download.gks");
+    std::cout << std::format("downloaded copy size matches: {}.\n", std::filesystem::file_size(tmpDir / "convote.gks") == std::filesystem::file_size(tmpDir / "convote_download.gks"));
+}
+
 int main(int argc, char** argv)
 {
     return 0;
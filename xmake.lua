@@ -9,6 +9,14 @@ option("spinner")
     set_default(true)
     add_defines("SPINNER")
 
+option("node32")
+    set_default(false)
+    set_description("Use 32-bit node IDs")
+
+option("offset32")
+    set_default(false)
+    set_description("Use 32-bit edge offsets and counts")
+
 target("graphkit/utils")
     set_kind("static")
     add_includedirs("src/include", {public = true})
@@ -23,6 +31,12 @@ target("graphkit")
     add_files("src/lib/graphkit/**.cpp")
     add_packages("libarchive", "cpr", "eigen", {public = true})
     add_deps("graphkit/utils")
+    if has_config("node32") then
+        add_defines("GKIT_NODE32", {public = true})
+    end
+    if has_config("offset32") then
+        add_defines("GKIT_OFFSET32", {public = true})
+    end
 
 target("graphkit/test")
     set_kind("binary")
@@ -30,6 +44,12 @@ target("graphkit/test")
     add_defines("PROJECT_DIR=\"$(projectdir)\"")
     add_deps("graphkit")
 
+target("graphkit/bench")
+    set_kind("binary")
+    add_files("src/bench/main.cpp")
+    add_defines("PROJECT_DIR=\"$(projectdir)\"")
+    add_deps("graphkit")
+
 --
 -- If you want to known more usage about xmake, please see https://xmake.io
 --